@@ -77,6 +77,85 @@ case "$2" in
 	buddy)
 		src="$code/tests/fpu.c $src"
 		;;
+	tickless_idle)
+		src="$code/tests/tickless_idle.c $src"
+		;;
+	waitq_index)
+		src="$code/tests/waitq_index.c $src"
+		;;
+	delayq_bench)
+		src="$code/tests/delayq_bench.c $src"
+		;;
+	delayq_bench_wheel)
+		opts="-DBAD_RTOS_USE_TIMING_WHEEL $opts"
+		src="$code/tests/delayq_bench.c $src"
+		;;
+	periodic)
+		src="$code/tests/periodic.c $src"
+		;;
+	timestamp)
+		src="$code/tests/timestamp.c $src"
+		;;
+	timestamp_tickless)
+		opts="-DBAD_RTOS_USE_TICKLESS_IDLE $opts"
+		src="$code/tests/timestamp.c $src"
+		;;
+	mutex_bench)
+		src="$code/tests/mutex_bench.c $src"
+		;;
+	msgq_fast)
+		src="$code/tests/msgq_fast.c $src"
+		;;
+	task_notify)
+		src="$code/tests/task_notify.c $src"
+		;;
+	isr_burst)
+		src="$code/tests/isr_burst.c $src"
+		;;
+	workq)
+		src="$code/tests/workq.c $src"
+		;;
+	threaded_irq)
+		src="$code/tests/threaded_irq.c $src"
+		;;
+	tlsf)
+		src="$code/tests/tlsf.c $src"
+		;;
+	kheap_arenas)
+		opts="${opts/stm32h562vgt6.ld/stm32h562vgt6_arenas.ld}" #the default h562 script keeps ram in one region
+		src="$code/tests/kheap_arenas.c $src"
+		;;
+	slab)
+		src="$code/tests/slab.c $src"
+		;;
+	kheap_magazines)
+		src="$code/tests/kheap_magazines.c $src"
+		;;
+	kheap_lazy_merge)
+		src="$code/tests/kheap_lazy_merge.c $src"
+		;;
+	mem_stats)
+		src="$code/tests/mem_stats.c $src"
+		;;
+	mem_stats_tlsf)
+		opts="-DBAD_RTOS_USE_KHEAP_TLSF $opts"
+		src="$code/tests/mem_stats.c $src"
+		;;
+	pool_wait)
+		src="$code/tests/pool_wait.c $src"
+		;;
+	stack_watermark)
+		src="$code/tests/stack_watermark.c $src"
+		;;
+	basic_tasks)
+		src="$code/tests/basic_tasks.c $src"
+		;;
+	coroutines)
+		src="$code/tests/coroutines.c $src"
+		;;
+	many_priorities)
+		src="$code/tests/many_priorities.c $src"
+		;;
 	*)
 		echo "No such target"
 		exit -1
@@ -51,6 +51,17 @@
 *         __edma_buffs = .;
 *     } > RAM
 *
+*  - With BAD_RTOS_USE_KHEAP_ARENAS link with stm32h562vgt6_arenas.ld, it splits ram per bank,
+*    the extra heap banks go right before .dma_buffs,
+*    tasks reach them through the same mpu region as the rest of the global data :
+*
+*   .heap_sram2 (NOLOAD) : ALIGN(32)
+*   {
+*         __heap_sram2 = .;
+*         . = ORIGIN(SRAM2) + LENGTH(SRAM2);
+*         __eheap_sram2 = .;
+*     } > SRAM2
+*
 *  - ! Kernel syscall interrupt priority is 0 on startup ,
 *      after startup it drops to lowest alowing isrs to run freely, 
 *      all the interaction between the kernel and isrs are done through pendsv triggering functions
@@ -189,7 +200,6 @@
 * @retval BAD_RTOS_STATUS_OK task is successfully unblocked
 * @retval BAD_RTOS_STATUS_HANDLE_INVALID handle is invalid
 * @retval BAD_RTOS_WRONG_CONTEXT if called from thread context
-* @retval BAD_RTOS_STATUS_ALLOC_FAIL failed to allocate kernel message 
 *
 * extern bad_rtos_status_t task_unblock_from_isr(bad_task_handle_t task);
 
@@ -220,7 +230,7 @@
 * 
 * Call this only when every resourse held by task is released
 *
-* If task holds mutexes which is reflected in tcb->mutex_count tries to trap
+* If task holds mutexes tries to trap, mutexes taken in thread mode are counted as well
 *
 * This function cannot be called from interrupt context. Will generate a fault if done so
 *
@@ -264,10 +274,143 @@
 * @retval BAD_RTOS_STATUS_OK tasks delay successfully canceled
 * @retval BAD_RTOS_STATUS_HANDLE_INVALID handle invalid 
 * @retval BAD_RTOS_WRONG_CONTEXT if called from thread context
-* @retval BAD_RTOS_STATUS_ALLOC_FAIL failed to allocate kernel message 
 *
 * extern bad_rtos_status_t task_delay_cancel_from_isr(bad_task_handle_t task);
 
+**
+* \b task_delay_until
+*
+* Public SVC (svc 0x9) call that calls internal function __task_delay_until
+* Delays the caller task until an absolute release tick (*last_wake + period)
+* 
+* Advances *last_wake by one period and delays the caller until that tick using the kernel delay queue,
+* since release times are absolute the work done between calls does not accumulate as drift.
+* Initialise last_wake with the current tick count before the first call
+*
+* If the release tick already passed the call returns immediately with BAD_RTOS_STATUS_OVERRUN,
+* the overrun counter and the worst lateness of the task are updated (see task_period_stats)
+*
+* Only available with BAD_RTOS_USE_PERIODIC_TASKS
+*
+* This function cannot be called from interrupt context. Will generate a fault if done so
+*
+* @param[in] uint32_t* last_wake pointer to the last release tick, updated by the call
+* @param[in] uint32_t period in ticks 
+*
+* @retval BAD_RTOS_STATUS_OK delayed until the release tick
+* @retval BAD_RTOS_STATUS_OVERRUN release tick already passed, not delayed
+* @retval BAD_RTOS_STATUS_WOKEN the task was woken by another task or isr
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS null pointer or zero period
+* @retval BAD_RTOS_STATUS_SCHED_LOCKED sched locked
+*
+* extern bad_rtos_status_t task_delay_until(uint32_t *last_wake, uint32_t period);
+
+**
+* \b task_wait_period
+*
+* Public SVC (svc 0x19) call that calls internal function __task_wait_period
+* task_delay_until for tasks created with a period in the descriptor, 
+* the release time is kept in the tcb and starts at the tick the task was made
+*
+* Only available with BAD_RTOS_USE_PERIODIC_TASKS
+*
+* This function cannot be called from interrupt context. Will generate a fault if done so
+*
+* @retval BAD_RTOS_STATUS_OK delayed until the next release tick
+* @retval BAD_RTOS_STATUS_OVERRUN release tick already passed, not delayed
+* @retval BAD_RTOS_STATUS_WOKEN the task was woken by another task or isr
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS task was created without a period
+* @retval BAD_RTOS_STATUS_SCHED_LOCKED sched locked
+*
+* extern bad_rtos_status_t task_wait_period();
+
+**
+* \b task_period_stats
+*
+* Public SVC (svc 0x1A) call that calls internal function __task_period_stats
+* Copies the period, missed releases and worst lateness (in ticks) of a task 
+*
+* Only available with BAD_RTOS_USE_PERIODIC_TASKS
+*
+* This function cannot be called from interrupt context. Will generate a fault if done so
+*
+* @param[in] bad_task_handle_t Task handle
+* @param[out] bad_period_stats_t* stats
+*
+* @retval BAD_RTOS_STATUS_OK stats copied
+* @retval BAD_RTOS_STATUS_HANDLE_INVALID handle invalid
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS null stats pointer
+* @retval BAD_RTOS_STATUS_SCHED_LOCKED sched locked
+*
+* extern bad_rtos_status_t task_period_stats(bad_task_handle_t task, bad_period_stats_t *stats);
+
+**
+* \b task_notify
+*
+* Public SVC (svc 0x1B) call that calls internal function __task_notify
+* Updates the notification word of a task and wakes it if it waits for any of the resulting bits
+* BAD_NOTIFY_SET_BITS ors bits in, BAD_NOTIFY_INCREMENT adds one, BAD_NOTIFY_OVERWRITE replaces the word
+*
+* Only available with BAD_RTOS_USE_TASK_NOTIFY
+*
+* This function cannot be called from interrupt context. Will generate a fault if done so
+*
+* @param[in] bad_task_handle_t Task handle
+* @param[in] uint32_t bits
+* @param[in] bad_notify_action_t action
+*
+* @retval BAD_RTOS_STATUS_OK word updated
+* @retval BAD_RTOS_STATUS_HANDLE_INVALID handle invalid
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS unknown action
+* @retval BAD_RTOS_STATUS_SCHED_LOCKED sched locked
+*
+* extern bad_rtos_status_t task_notify(bad_task_handle_t task, uint32_t bits, bad_notify_action_t action);
+
+**
+* \b task_notify_from_isr
+*
+* Public function
+* task_notify for interrupts, the word is updated in place and the wake goes through the isr queue
+* Several notifies before the kernel gets to run fold into one wake
+*
+* Only available with BAD_RTOS_USE_TASK_NOTIFY
+*
+* @param[in] bad_task_handle_t Task handle
+* @param[in] uint32_t bits
+* @param[in] bad_notify_action_t action
+*
+* @retval BAD_RTOS_STATUS_OK word updated
+* @retval BAD_RTOS_STATUS_HANDLE_INVALID handle invalid
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS unknown action
+* @retval BAD_RTOS_STATUS_WRONG_CONTEXT not called from an isr
+*
+* extern bad_rtos_status_t task_notify_from_isr(bad_task_handle_t task, uint32_t bits, bad_notify_action_t action);
+
+**
+* \b task_notify_wait
+*
+* Public SVC (svc 0x1C) call that calls internal function __task_notify_wait
+* Waits until the notification word of the calling task has any of the bits in mask set,
+* those bits are cleared on exit and the word as it was before clearing is written to value
+* Delay follows the synchro objects: 0 waits forever, UINT32_MAX does not block
+*
+* Only available with BAD_RTOS_USE_TASK_NOTIFY
+*
+* This function cannot be called from interrupt context. Will generate a fault if done so
+*
+* @param[in] uint32_t mask
+* @param[in] uint32_t delay
+* @param[out] uint32_t* value, may be null
+*
+* @retval BAD_RTOS_STATUS_OK notified
+* @retval BAD_RTOS_STATUS_TIMEOUT delay ran out
+* @retval BAD_RTOS_STATUS_WOULD_BLOCK no bits set and delay is UINT32_MAX
+* @retval BAD_RTOS_STATUS_WOKEN the wait was cancelled by task_delay_cancel
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS zero mask
+* @retval BAD_RTOS_STATUS_SCHED_LOCKED sched locked
+*
+* extern bad_rtos_status_t task_notify_wait(uint32_t mask, uint32_t delay, uint32_t *value);
+
 **
 * \b sched_lock 
 *
@@ -331,6 +474,9 @@
 *
 * This function can be called from interrupt context. This function is reentrant
 *
+* With BAD_RTOS_USE_POOL_WAIT a task that finds waiters hands the block straight to the first one (svc 0xFE),
+* an isr pushes it to the free list and leaves the hand over to pendsv
+*
 * @param[in] bad_pool_t pool to free to 
 * 
 * @retval void * to allocated memory
@@ -338,12 +484,32 @@
 *
 * extern void pool_free(bad_pool_t *pool, void *obj);
 
+**
+* \b pool_alloc_wait
+*
+* Public function 
+* Same as pool_alloc while the pool has blocks, the free list and the untouched memory are tried
+* without entering the kernel
+* On an empty pool the caller is queued on the wait list of the pool (svc 0x20), waiters are
+* kept in priority order and the first one gets the block of the next pool_free directly
+*
+* Only available with BAD_RTOS_USE_POOL_WAIT
+*
+* This function cannot be called from interrupt context.
+* @param[in] bad_pool_t pool to allocate from 
+* @param[in] uint32_t delay in ticks, 0 waits forever, UINT32_MAX does not wait
+* 
+* @retval void * to allocated memory
+* @retval Null ptr timeout, the pool stayed empty or the scheduler is locked
+*
+* extern void* pool_alloc_wait(bad_pool_t *pool, uint32_t delay);
+
 **
 * \b gpool_alloc
 *
 * Public function 
 * Specialised pool_alloc function that operates on kernel provided global pool which
-* can be used to allocate all synchro objects,(or any object 16 bytes in size)
+* can be used to allocate all synchro objects,(or any object up to sizeof(bad_gpool_block_t))
 * !!!EXCEPT message queues and pools
 *
 * This function can be called from interrupt context. This function is reentrant 
@@ -366,13 +532,39 @@
 *
 * extern void gpool_free(void *obj);
 
+**
+* \b pool_stats
+*
+* Public function 
+* Takes a snapshot of the counters of a pool, capacity, free blocks, fewest free blocks seen
+* since pool_init and allocations that failed
+* The counters are updated with ldrex/strex next to the lock free list, the snapshot rereads
+* them until no alloc or free raced it, so free never reads above the capacity nor below min_free
+*
+* Only available with BAD_RTOS_USE_HEAP_STATS
+*
+* This function can be called from interrupt context. This function is reentrant
+* @param[in] bad_pool_t pool to read
+* @param[out] bad_pool_stats_t writeback
+* 
+* @retval BAD_RTOS_STATUS_OK
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS null pointer or pool was not initialised
+*
+* extern bad_rtos_status_t pool_stats(bad_pool_t *pool, bad_pool_stats_t *stats);
+
 **
 * \b kernel_alloc
 *
 * Public SVC (svc 0xF2) call that calls internal function __kernel_alloc
 * Tries to allocate a specifed number of bytes from kernel heap
 *
-* Uses buddy allocator under the hood
+* Uses buddy allocator under the hood, sizes are rounded up to a power of two
+* With BAD_RTOS_USE_KHEAP_TLSF uses a tlsf allocator instead, sizes are rounded up to KHEAP_ALIGN
+* plus an 8 byte header, returned blocks are KHEAP_ALIGN aligned
+*
+* With BAD_RTOS_USE_KHEAP_MAGAZINES this is a thread mode function, blocks of the first
+* BAD_RTOS_MAGAZINE_ORDERS orders (from KMIN_ORDER) come from a per task magazine and the svc
+* is only taken to refill an empty one (svc 0xFB), sizes in those orders are allocated as the whole order
 *
 * This function cannot be called from interrupt context. 
 * @param[in] uint32_t size in bytes 
@@ -388,7 +580,12 @@
 * Public SVC (svc 0xF3) call that calls internal function __kernel_free
 * Tries to free a specifed number of bytes allocated from kernel heap
 *
-* Uses buddy allocator under the hood
+* Uses buddy allocator under the hood, the tlsf backend ignores the size
+* With BAD_RTOS_USE_KHEAP_LAZY_MERGE the buddy free is O(1), the block goes on the list of its order
+* and free pairs are merged later by the idle task (svc 0x1F) or by an allocation that found nothing
+*
+* With BAD_RTOS_USE_KHEAP_MAGAZINES small blocks go to the magazine of the calling task,
+* half of a full magazine is flushed to the heap (svc 0xFC), a finishing task flushes all of it
 *
 * This function cannot be called from interrupt context.
 * @param[in] void * to allocated memory 
@@ -397,6 +594,180 @@
 *
 * extern void kernel_free(void *block,uint32_t size);
 
+**
+* \b kernel_alloc_from
+*
+* Public SVC (svc 0xF9) call that calls internal function __kernel_alloc_from
+* Tries to allocate a specifed number of bytes from the heap arenas picked by the policy
+*
+* Arena 0 is kheap, the next ones are the BAD_RTOS_KHEAP_BANKS linker ranges, listed fastest first
+* Every arena has its own tlsf instance, kernel_alloc and dynamic task stacks use BAD_KHEAP_FASTEST_FIRST
+* Blocks from any arena are freed with kernel_free
+*
+* Policies:
+*   BAD_KHEAP_FASTEST_FIRST                 every arena in order
+*   BAD_KHEAP_BANK(arena)                   only the given arena
+*   BAD_KHEAP_CHAIN(first,second)           the listed arenas in order, CHAIN3 takes three
+*
+* Only available with BAD_RTOS_USE_KHEAP_ARENAS
+*
+* This function cannot be called from interrupt context. 
+* @param[in] uint32_t size in bytes 
+* @param[in] bad_kheap_policy_t arena policy
+* 
+* @retval void * to allocated memory
+* @retval Null ptr allocation failed 
+*
+* extern void* kernel_alloc_from(uint32_t size, bad_kheap_policy_t policy);
+
+**
+* \b kernel_mem_stats
+*
+* Public SVC (svc 0xFD) call that calls internal function __kernel_mem_stats
+* Copies the kernel memory counters, the buddy kernel heap, the tcb slab and the global pool
+*
+* Heap: free bytes, low water mark of the free bytes, largest block a single kernel_alloc can get,
+* allocation and failure counters and free blocks per order, taken inside the svc so they agree
+* with each other. Free blocks per order walk the free lists, everything else is kept by the heap.
+* Blocks held by magazines and slab pages count as allocated. With BAD_RTOS_USE_KHEAP_LAZY_MERGE
+* the call merges every free pair first, like an allocation that found nothing would
+* With the tlsf backend the sizes count whole blocks, headers included, summed over all arenas,
+* the largest block is the largest of the arenas and there are no free blocks per order
+*
+* Only available with BAD_RTOS_USE_HEAP_STATS
+*
+* This function cannot be called from interrupt context, use pool_stats(&gpool) there
+* @param[out] bad_mem_stats_t writeback
+* 
+* @retval BAD_RTOS_STATUS_OK
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS null pointer
+*
+* extern bad_rtos_status_t kernel_mem_stats(bad_mem_stats_t *stats);
+
+**
+* \b stack_stats
+*
+* Public function, calls internal function __stack_stats through svc 0xFF
+* Reports the configured size, the deepest use so far and a recommended size for one stack
+*
+* task_make paints the whole stack, the idle task checks BAD_RTOS_STACK_SCAN_BATCH words of one stack
+* per wakeup from the bottom up (svc 0x21) and moves its mark to the first written word,
+* this call finishes the scan of the requested stack so the result is always up to date
+* The idle task is handle 0, BAD_STACK_MSP reads the exception stack, BAD_RTOS_MSP_STACK_SIZE bytes
+* below __estack painted by bad_rtos_start
+* The recommended size is the peak plus BAD_RTOS_STACK_MARGIN percent, rounded to the size
+* and alignment limits of TASK_STATIC_STACK
+*
+* Only available with BAD_RTOS_USE_STACK_WATERMARK
+*
+* This function cannot be called from interrupt context.
+* @param[in] bad_task_handle_t task, 0 for the idle task or BAD_STACK_MSP
+* @param[out] bad_stack_stats_t writeback
+* 
+* @retval BAD_RTOS_STATUS_OK
+* @retval BAD_RTOS_STATUS_HANDLE_INVALID task finished or never existed
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS null pointer
+*
+* extern bad_rtos_status_t stack_stats(bad_task_handle_t handle, bad_stack_stats_t *stats);
+
+**
+* \b stack_report
+*
+* Public function 
+* Prints one line per stack, every running task, the idle task and the exception stack:
+* handle, size, peak use and recommended size in bytes
+* Characters go through the given putc, a polling uart write or semihost_putc
+*
+* Only available with BAD_RTOS_USE_STACK_WATERMARK
+*
+* This function cannot be called from interrupt context.
+* @param[in] bad_putc_t character output
+*
+* extern void stack_report(bad_putc_t putc);
+
+**
+* \b semihost_putc
+*
+* Public function 
+* Writes a character to the debugger console (semihosting SYS_WRITEC)
+* Halts on the breakpoint without a debugger attached
+*
+* Only available with BAD_RTOS_USE_STACK_WATERMARK
+*
+* extern void semihost_putc(char c);
+
+**
+* \b slab_alloc
+*
+* Public function 
+* Allocates an object from the size class caches (8, 16, 32 ... 512 bytes)
+* The object is pulled from the free list of its class with ldrex/strex, no svc is taken,
+* only an empty class refills through svc 0xFA, it carves a BAD_RTOS_SLAB_PAGE_SIZE page from the kernel heap
+* Sizes above 512 go straight to kernel_alloc
+*
+* Pages stay with their class once carved, freed objects are only reused by the same class
+*
+* Only available with BAD_RTOS_USE_SLAB
+*
+* This function can be called from interrupt context, it returns null there when the class is empty
+* @param[in] uint32_t size in bytes 
+* 
+* @retval void * to allocated memory
+* @retval Null ptr allocation failed 
+*
+* extern void* slab_alloc(uint32_t size);
+
+**
+* \b slab_free
+*
+* Public function 
+* Returns an object to the free list of its size class, never enters the kernel
+* Sizes above 512 are handed to kernel_free
+*
+* Only available with BAD_RTOS_USE_SLAB
+*
+* This function can be called from interrupt context for sizes up to 512, bigger ones trap there
+* @param[in] void * to allocated memory 
+* @param[in] uint32_t size in bytes, same as passed to slab_alloc
+*
+* extern void slab_free(void *obj, uint32_t size);
+
+// Time api
+**
+* \b kernel_ticks64
+*
+* Public function 
+* Returns the number of ticks since the kernel start, extended to 64 bits
+* Reads a copy of the tick count kept in unprivileged memory, retries if the tick handler
+* updated it in the middle of the read, no svc is taken
+*
+* Only available with BAD_RTOS_USE_SHARED_TIME
+*
+* This function can be called from interrupt context. This function is reentrant
+*
+* @retval uint64_t ticks since start
+*
+* extern uint64_t kernel_ticks64();
+
+**
+* \b kernel_timestamp
+*
+* Public function 
+* Returns the number of systick clock cycles since the kernel start,
+* the tick count combined with the current systick counter value
+* Systick registers are privileged, called from an unprivileged task it takes svc 0xF6 
+* (allowed while the scheduler is locked) that calls internal function __kernel_timestamp, 
+* interrupts and privileged code read the registers directly
+* Stays monotonic across tickless idle periods
+*
+* Only available with BAD_RTOS_USE_SHARED_TIME
+*
+* This function can be called from interrupt context. This function is reentrant
+*
+* @retval uint64_t systick cycles since start
+*
+* extern uint64_t kernel_timestamp();
+
 // Priority inheriting mutex api
 **
 * \b mutex_init
@@ -418,10 +789,14 @@
 **
 * \b mutex_take
 *
-* Public SVC (svc 0xA) call that calls internal function __mutex_take
+* Public function 
 * Tries to take the mutex
-* If the mutex has no owner then the caller becomes the mutexes owner, increasing his mutex count by 1  
-* If it has an owner the behavior depends on the delay value specified
+* If the mutex has no owner then the caller becomes the mutexes owner, this is done with ldrex/strex 
+* in thread mode without entering the kernel
+* If the caller already owns the mutex the take is counted and needs a matching put
+* If another task owns it and delay is not -1 SVC (svc 0xE) that calls internal function __mutex_take is taken,
+* the mutex is marked contended and owners mutex count is increased by 1 
+* The behavior then depends on the delay value specified
 *
 * delay = 0 : task is blocked. Task is inserted into mutexes blocking priority queue and 
 * if this tasks priority is higher than the owners priority owner inherits priority of the blocked task
@@ -433,9 +808,7 @@
 * If the task doesnt become mutexes owner in N ticks task is removed from mutexes blocking queue and reinserted 
 * into ready queue with BAD_RTOS_STATUS_TIMEOUT code in tasks stacked registers
 *
-* This api cannot be called recursively
-*
-* This function cannot be called from interrupt context.Will generate a fault if done so
+* This function cannot be called from interrupt context.
 *
 * @param[in] bad_mutex_t* Ptr to mutex object to try take  
 * @param[in] uint32_t delay ticks 0 = block, -1 = dont block, N = block for N ticks
@@ -451,10 +824,12 @@
 **
 * \b mutex_put
 *
-* Public SVC (svc 0xB) call that calls internal function __mutex_put
+* Public function 
 * Tries to put the mutex
 *
-* If the caller is the owner then the highest priority blocked task is woken with BAD_RTOS_STATUS_OK written to its 
+* Recursive takes and uncontended mutexes are put with ldrex/strex in thread mode without entering the kernel
+* If the mutex is contended SVC (svc 0xD) that calls internal function __mutex_put is taken, 
+* the highest priority blocked task is woken with BAD_RTOS_STATUS_OK written to its 
 * stacked registers, its callback is canceled and tries to preempt the current running task. 
 * If there is no blocked task mutex becomes free. Previous owners mutex count is decreased
 * by 1 and if it is 0 previous owners priority is reset to base priority
@@ -462,13 +837,14 @@
 * If the caller is not the owner BAD_RTOS_STATUS_NOT_OWNER returned
 *
 *
-* This function cannot be called from interrupt context.Will generate a fault if done so
+* This function cannot be called from interrupt context.
 *
 * @param[in] bad_mutex_t* Ptr to mutex object to try put  
 *
 * @retval BAD_RTOS_STATUS_OK Mutex successfully put
 * @retval BAD_RTOS_STATUS_NOT_OWNER caller is not the owner of this mutex object
 * @retval BAD_RTOS_STATUS_BAD_PARAMETERS mutex object is NULL
+* @retval BAD_RTOS_STATUS_WRONG_CONTEXT function was called from an isr
 * @retval BAD_RTOS_STATUS_SCHED_LOCKED sched locked
 *
 * extern bad_rtos_status_t mutex_put(bad_mutex_t *mut);
@@ -476,7 +852,7 @@
 **
 * \b mutex_delete
 *
-* Public SVC (svc 0xC) call that calls internal function __mutex_delete
+* Public SVC (svc 0xF) call that calls internal function __mutex_delete
 * Tries to delete the mutex object, doesnt infuence the underlying memory, just resets the object
 *
 * If the caller is the owner then wakes up all the tasks with BAD_RTOS_STATUS_DELETED written into their 
@@ -584,7 +960,6 @@
 * @retval BAD_RTOS_STATUS_BAD_PARAMETERS semaphore object is NULL
 * @retval BAD_RTOS_STATUS_NOT_INITIALISED init flag is 0
 * @retval BAD_RTOS_WRONG_CONTEXT if called from thread context
-* @retval BAD_RTOS_ALLOC_FAIL failed to allocate kernel message object
 *
 * extern bad_rtos_status_t sem_put_from_isr(bad_sem_t *sem);
 
@@ -687,15 +1062,19 @@
 **
 * \b msgq_pull_msg
 *
-* Public SVC call (svc 0x10) that calls internal function __msgq_pull_msg.
+* Public function 
 * Tries to pull (receive) a message from the queue. Only the owner task can pull messages.
+* A message is pulled in thread mode without entering the kernel, if the queue is empty (or its oldest slot 
+* is still being written by a thread mode post) SVC (svc 0x11) that calls internal function __msgq_pull_msg is taken
 *
 * If the queue is empty, the behavior depends on the delay value specified:
 * delay = 0 : task is blocked until a message arrives.
 * delay = -1 : pull fails and returns immediately.
 * delay = N : task tries to pull for N ticks. If N ticks pass, task is woken with timeout status.
 *
-* If space frees up in the queue after pulling, a blocked publisher task is awakened.
+* If space frees up in the queue after pulling, a blocked publisher task is awakened (svc 0xF7).
+*
+* This function cannot be called from interrupt context.
 *
 * @param[in] bad_msgq_t* q Ptr to message queue to pull from
 * @param[out] bad_msg_block_t* writeback Ptr to memory where the pulled message will be copied
@@ -707,14 +1086,18 @@
 * @retval BAD_RTOS_STATUS_NOT_OWNER Current task is not the owner of this queue
 * @retval BAD_RTOS_STATUS_WOULD_BLOCK delay is -1 and queue is empty
 * @retval BAD_RTOS_STATUS_TIMEOUT blocked for N ticks without receiving a message
+* @retval BAD_RTOS_STATUS_WRONG_CONTEXT function was called from an isr
 *
 * extern bad_rtos_status_t msgq_pull_msg(bad_msgq_t *q, bad_msg_block_t *writeback, uint32_t delay);
 
 **
 * \b msgq_post_msg
 *
-* Public SVC call (svc 0x11) that calls internal function __msgq_post_msg.
+* Public function 
 * Tries to post a message (signal + args) to the queue. Any task can post to the queue.
+* The slot is reserved and written in thread mode without entering the kernel, SVC (svc 0x10) that calls 
+* internal function __msgq_post_msg is taken if the queue is full, a task is blocked on it or another 
+* task is in the middle of a thread mode post to it
 *
 * If the queue is full, the behavior depends on the delay value specified:
 * delay = 0 : task is blocked until space becomes available.
@@ -724,6 +1107,8 @@
 * If the queue was previously empty and the owner is waiting, the owner is awakened 
 * and receives the message immediately.
 *
+* This function cannot be called from interrupt context.
+*
 * @param[in] bad_msgq_t* q Ptr to message queue to post to
 * @param[in] uint32_t signal The 32-bit signalID of the message
 * @param[in] void* args Ptr to message arguments or payload
@@ -734,6 +1119,7 @@
 * @retval BAD_RTOS_STATUS_NOT_INITIALISED Queue capacity is 0
 * @retval BAD_RTOS_STATUS_WOULD_BLOCK delay is -1 and queue is full
 * @retval BAD_RTOS_STATUS_TIMEOUT blocked for N ticks without space freeing up
+* @retval BAD_RTOS_STATUS_WRONG_CONTEXT function was called from an isr
 *
 * extern bad_rtos_status_t msgq_post_msg(bad_msgq_t *q, uint32_t signal, void *args, uint32_t delay);
 
@@ -758,7 +1144,6 @@
 * @retval BAD_RTOS_STATUS_BAD_PARAMETERS q is NULL
 * @retval BAD_RTOS_STATUS_NOT_INITIALISED Queue capacity is 0
 * @retval BAD_RTOS_STATUS_WOULD_BLOCK Queue is full, cannot post
-* @retval BAD_RTOS_STATUS_ALLOC_FAIL failed to allocate kernel message
 *
 * extern bad_rtos_status_t msgq_post_msg_from_isr(bad_msgq_t *q, uint32_t signal, void *args);
  
@@ -838,7 +1223,6 @@
 * @retval BAD_RTOS_STATUS_WRONG_CONTEXT if called from thread context instead of ISR
 * @retval BAD_RTOS_STATUS_NOT_INITIALISED barrier count is 0 (unprimed)
 * @retval BAD_RTOS_STATUS_FIRED the barrier has already fired
-* @retval BAD_RTOS_STATUS_ALLOC_FAIL failed to allocate kernel message
 *
 * extern bad_rtos_status_t event_barrier_fire_from_isr(bad_event_barrier_t *event_barrier, uint32_t flag);
 
@@ -879,6 +1263,209 @@
 *
 * extern bad_rtos_status_t event_barrier_delete(bad_event_barrier_t *event_barrier);
 
+//Deferred work
+//Macro for static work item definition, fn gets called with arg from a worker task
+#define WORK_STATIC_INIT(name,work_fn,work_arg)
+
+**
+* \b work_submit_from_isr
+*
+* Public kernel notification function
+* Queues a work item for the worker tasks, the item is linked in place so this never allocates
+* An item runs once per submit, submitting it again before a worker picks it up is refused
+*
+* Only available with BAD_RTOS_USE_WORKQ
+*
+* This function must be called from interrupt context
+* @param[in] bad_work_t* Ptr to work item
+*
+* @retval BAD_RTOS_STATUS_OK item queued
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS null item or item without a function
+* @retval BAD_RTOS_STATUS_IN_USE item is already queued
+* @retval BAD_RTOS_STATUS_WRONG_CONTEXT if called from thread context
+*
+* extern bad_rtos_status_t work_submit_from_isr(bad_work_t *work);
+
+**
+* \b work_worker
+*
+* Public task entry
+* Drains the deferred work queue, create one or more tasks with this entry through task_make,
+* their priorities, stacks and mpu regions decide where deferred work runs
+* Work functions run in the worker task, they may block and submit other work
+* A worker runs everything it finds queued, the queue is popped through svc 0x1D so workers never race
+*
+* Only available with BAD_RTOS_USE_WORKQ
+*
+* extern void work_worker(void *unused);
+
+//Basic tasks
+//Macro for static basic task definition, fn gets called with arg on the shared stack of level
+#define BASIC_TASK_STATIC_INIT(name,task_fn,task_arg,task_level)
+
+**
+* \b basic_task_activate
+*
+* Public kernel notification function
+* Queues a basic task on the activation queue of its level and wakes the level runner,
+* the task is linked in place so this never allocates
+* Basic tasks run to completion on the stack of their level runner, one after another in activation order
+* A task runs once per activation, activating it again before it starts is refused
+* Cost: an activation wakes the level runner through its semaphore like any task wake, so when the runner
+* is idle it costs a full context switch into the runner and one back out. Activations queued while the
+* runner is already draining its level (a burst, or chained from another basic task of the level) run
+* with a plain call and no switch. Basic tasks save stack ram, not the context switch
+*
+* Only available with BAD_RTOS_USE_BASIC_TASKS
+*
+* This function can be called from thread and interrupt context
+* @param[in] bad_basic_task_t* Ptr to basic task
+*
+* @retval BAD_RTOS_STATUS_OK task queued
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS null task, task without a function or level out of range
+* @retval BAD_RTOS_STATUS_IN_USE task is already queued
+* @retval BAD_RTOS_STATUS_SCHED_LOCKED task queued but the runner was not woken, it runs with the next activation of the level
+*
+* extern bad_rtos_status_t basic_task_activate(bad_basic_task_t *task);
+
+**
+* \b basic_runner
+*
+* Public task entry
+* Runs the basic tasks of one level, create exactly one task per level through task_make with
+* the level number (0 to BAD_RTOS_BASIC_LEVELS - 1) as the argument
+* The runner priority is the priority of the level, its stack is shared by every basic task of the level
+* and has to fit the deepest of them, its mpu regions apply to all of them
+* A wakeup drains the whole queue with plain calls, see basic_task_activate for the activation cost
+* The queue and the runner loop are the ones work_worker uses, only the pop differs
+* Basic tasks must not block, while one runs blocking calls (delays, waits, blocking takes) of its runner
+* fail with BAD_RTOS_STATUS_WRONG_CONTEXT, polling with delay UINT32_MAX still works
+* A level number out of range finishes the runner
+*
+* Only available with BAD_RTOS_USE_BASIC_TASKS
+*
+* extern void basic_runner(void *level);
+
+//Coroutines
+//Stackless coroutines multiplexed inside one host task, a coroutine is a function
+//bad_coro_state_t fn(bad_coro_t *coro) whose body sits between CORO_BEGIN and CORO_END
+//Locals do not survive an await, keep state in the object passed as arg, a switch statement
+//around an await breaks the resume points
+#define CORO_BEGIN(coro)
+#define CORO_END(coro)
+//Return to the scheduler, the coroutine continues with the next pass
+#define CORO_YIELD(coro)
+//Wait until cond is true, it is evaluated on every pass of the scheduler. Conditions on plain variables
+//have to be paired with a sem_put on the scheduler signal by the code that changes them
+#define CORO_WAIT_UNTIL(coro,cond)
+//Wait for ticks (at least 1)
+#define CORO_DELAY(coro,ticks)
+//Awaited objects are bound to the scheduler until the await ends, BAD_RTOS_STATUS_IN_USE if another scheduler awaits them
+//Take a semaphore, delay and status as in sem_take, BAD_RTOS_STATUS_TIMEOUT when the delay passed
+#define CORO_SEM_TAKE(coro,sem,delay,status)
+//Pull a message from a queue owned by the host task, delay and status as in msgq_pull_msg
+#define CORO_MSGQ_PULL(coro,q,writeback,delay,status)
+
+**
+* \b coro_sched_init
+*
+* Public function
+* Initialises a coroutine scheduler, its signal semaphore is the wait set of the host task,
+* every sem and msgq a coroutine awaits puts it when something is posted
+*
+* Only available with BAD_RTOS_USE_COROUTINES
+*
+* @param[in] bad_coro_sched_t* Ptr to scheduler
+*
+* @retval BAD_RTOS_STATUS_OK scheduler initialised
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS null scheduler
+*
+* extern bad_rtos_status_t coro_sched_init(bad_coro_sched_t *sched);
+
+**
+* \b coro_spawn
+*
+* Public function
+* Adds a coroutine to a scheduler, it first runs on the next pass
+* The coroutine object is linked in place and has to stay valid until the coroutine finishes
+*
+* Only available with BAD_RTOS_USE_COROUTINES
+*
+* This function must be called from the host task (also from coroutines) or before coro_sched_run
+* @param[in] bad_coro_sched_t* Ptr to scheduler
+* @param[in] bad_coro_t* Ptr to coroutine object
+* @param[in] bad_coro_fn_t coroutine function
+* @param[in] void* arg, available as coro->arg
+*
+* @retval BAD_RTOS_STATUS_OK coroutine added
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS null scheduler, coroutine or function
+*
+* extern bad_rtos_status_t coro_spawn(bad_coro_sched_t *sched, bad_coro_t *coro, bad_coro_fn_t fn, void *arg);
+
+**
+* \b coro_sched_run
+*
+* Public function
+* Runs the coroutines of a scheduler in the calling (host) task, returns once all of them finished
+* Every pass resumes each coroutine once, the host blocks on the signal semaphore only when a pass
+* ended with every coroutine waiting, until a post to an awaited object or the earliest coroutine deadline
+* A pass costs one call per coroutine, waits are polled in the host without entering the kernel
+*
+* Only available with BAD_RTOS_USE_COROUTINES
+*
+* This function must be called from thread context
+* @param[in] bad_coro_sched_t* Ptr to scheduler
+*
+* extern void coro_sched_run(bad_coro_sched_t *sched);
+
+//Threaded interrupts
+//Macro for a kernel provided isr that hands the line to its registered task, put the startup vector name in
+#define THREADED_IRQ_HANDLER(isr_name)
+
+**
+* \b irq_thread_register
+*
+* Public SVC (svc 0xF8) call that calls internal function __irq_thread_register
+* Binds an nvic line to a handler task, the line is disabled until the task first waits on it
+* Can be called before the kernel is started
+*
+* The vector of the line must be a THREADED_IRQ_HANDLER, it masks the line in the nvic
+* and unblocks the task, the task does the work at its own priority and waits again with irq_thread_wait
+*
+* Only available with BAD_RTOS_USE_THREADED_IRQ
+*
+* @param[in] uint32_t nvic line number
+* @param[in] bad_task_handle_t handler task
+*
+* @retval BAD_RTOS_STATUS_OK line bound
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS line number out of range
+* @retval BAD_RTOS_STATUS_HANDLE_INVALID handle is invalid
+* @retval BAD_RTOS_STATUS_ALREADY_BOUND line is bound to another task
+*
+* extern bad_rtos_status_t irq_thread_register(uint32_t irqn, bad_task_handle_t task);
+
+**
+* \b irq_thread_wait
+*
+* Public SVC (svc 0x1E) call that calls internal function __irq_thread_wait
+* Blocks the handler task and unmasks its line in the nvic, returns when the line fires
+* An interrupt that came in while the task was working stays pending and fires right away
+*
+* Only the task bound to the line can wait on it
+*
+* Only available with BAD_RTOS_USE_THREADED_IRQ
+*
+* This function cannot be called from interrupt context. Will generate a fault if done so
+* @param[in] uint32_t nvic line number
+*
+* @retval BAD_RTOS_STATUS_OK line fired (or the task was unblocked by task_unblock)
+* @retval BAD_RTOS_STATUS_BAD_PARAMETERS line number out of range
+* @retval BAD_RTOS_STATUS_NOT_OWNER line is not bound to the calling task
+* @retval BAD_RTOS_STATUS_WRONG_CONTEXT called from a basic task
+* @retval BAD_RTOS_STATUS_SCHED_LOCKED sched locked
+*
+* extern bad_rtos_status_t irq_thread_wait(uint32_t irqn);
+
 //Mpu Macros
 **
 * /b START_TASK_MPU_REGIONS_DEFINITIONS
@@ -944,11 +1531,48 @@
 #define BAD_RTOS_USE_MPU        //mpu
 #define BAD_RTOS_USE_FPU        //fpu
 #define BAD_RTOS_FPU_DEFAULT_SETTINGS //use default settings for the fpu (lazy + auto stacking enabled),if custom settings used - comment this and enable lazy stacking
+//#define BAD_RTOS_USE_TICKLESS_IDLE        //stop the periodic tick while idle, systick is reprogrammed to expire at the head of the delay queue
+//#define BAD_RTOS_TICKLESS_MIN_IDLE_TICKS 2 //dont bother stopping the tick for shorter idle periods
+//#define BAD_RTOS_USE_TIMING_WHEEL         //hashed timing wheel delay queue (O(1) insert and cancel) instead of the delta list
+//#define BAD_RTOS_USE_WAITQ_INDEX          //priority bitmap index for synchro wait queues (O(1) block), costs 4 + BAD_RTOS_WAITQ_LEVELS bytes per object
+//#define BAD_RTOS_WAITQ_LEVELS (8)         //wait queue index levels (up to 32), priorities share them evenly, waiters of a shared level are sorted by a short walk, defaults to BAD_RTOS_PRIO_COUNT up to 8
+//#define BAD_RTOS_USE_PERIODIC_TASKS       //task_delay_until and periodic task descriptors with overrun and lateness stats
+//#define BAD_RTOS_USE_SHARED_TIME          //64 bit tick count readable by tasks without an svc and sub tick systick timestamps
+//#define BAD_RTOS_USE_TASK_NOTIFY          //notification word in every tcb, signalled by handle from tasks and isrs
+//#define BAD_RTOS_USE_WORKQ                //deferred isr work (work_submit_from_isr) run by user created work_worker tasks, needs semaphores
+//#define BAD_RTOS_USE_THREADED_IRQ         //irq handlers run in tasks, the line stays masked in the nvic until its task waits again
+//#define BAD_RTOS_USE_KHEAP_TLSF           //two level segregated fit kernel heap instead of the buddy, O(1) and no power of two rounding
+//#define KHEAP_SIZE (3000)                 //tlsf heap size, up to 1 << KHEAP_TLSF_MAX_ORDER, defaults to 1 << KMAX_ORDER
+//#define KHEAP_TLSF_MAX_ORDER 18           //largest tlsf block (1 << 18 = 256k), sizes the class table, defaults to KMAX_ORDER, 18 with arenas
+//#define BAD_RTOS_USE_KHEAP_ARENAS         //kernel heap spread over several ram banks (kernel_alloc_from), arena 0 is kheap, needs the tlsf heap
+//#define BAD_RTOS_USE_SLAB                 //size class caches (slab_alloc) for 8 to 512 byte objects on pages from the kernel heap, no svc on the fast path
+//#define BAD_RTOS_SLAB_PAGE_SIZE (512)     //bytes taken from the kernel heap per refill, at least 512
+//#define BAD_RTOS_USE_KHEAP_MAGAZINES      //per task caches of small kernel heap blocks, kernel_alloc and kernel_free only take an svc to refill or flush
+//#define BAD_RTOS_MAGAZINE_ORDERS (3)      //cached orders starting at KMIN_ORDER (32, 64, 128 bytes)
+//#define BAD_RTOS_MAGAZINE_SIZE (4)        //blocks per order and task, half of them move per refill or flush
+//#define BAD_RTOS_USE_KHEAP_LAZY_MERGE     //buddy frees skip coalescing, free pairs are merged by the idle task in batches or when an allocation fails
+//#define BAD_RTOS_KHEAP_MERGE_BATCH (16)   //free blocks the idle task visits per wakeup
+//#define BAD_RTOS_USE_HEAP_STATS           //kernel heap, tcb slab and pool counters (kernel_mem_stats, pool_stats)
+//#define BAD_RTOS_USE_POOL_WAIT            //pool_alloc_wait, tasks block on an empty pool and pool_free hands blocks to them
+//#define BAD_RTOS_USE_STACK_WATERMARK      //paint stacks at task_make, the idle task tracks how deep they go (stack_stats, stack_report)
+//#define BAD_RTOS_STACK_SCAN_BATCH (32)    //stack words the idle task checks per wakeup
+//#define BAD_RTOS_MSP_STACK_SIZE (1024)    //exception stack painted below __estack, has to be free ram
+//#define BAD_RTOS_STACK_MARGIN (25)        //percent added to the peak for the recommended size
+//#define BAD_RTOS_USE_BASIC_TASKS          //run to completion basic tasks (basic_task_activate) sharing one basic_runner stack per level, needs semaphores
+//#define BAD_RTOS_BASIC_LEVELS (2)         //basic task levels, one runner task each
+//#define BAD_RTOS_USE_COROUTINES           //stackless coroutines run by coro_sched_run inside one task, await sems, msgqs and delays, needs semaphores and shared time
+//#define BAD_RTOS_KHEAP_BANKS {&__heap_sram2,&__eheap_sram2},{&__heap_sram3,&__eheap_sram3} //extra arenas as linker symbol pairs, fastest first
+//#define KHEAP_ALIGN_LOG2 5                //tlsf block alignment (size = 1 << KHEAP_ALIGN_LOG2 = 32), at least 3
+//#define KHEAP_TLSF_SL_LOG2 4              //tlsf classes per power of two (1 << 4 = 16), worst case rounding is 1/16 of the size
 
 #define BAD_RTOS_FLASH_SIZE         (0x80000)
 #define BAD_RTOS_GLOBAL_POOL_SIZE   (128)
-#define BAD_RTOS_MAX_TASKS          (32)   //maximum number of running tasks, number of user priorities = BAD_RTOS_MAX_TASKS-2, with idle task running at BAD_RTOS_MAX_TASKS-1
+#ifndef BAD_RTOS_MAX_TASKS
+#define BAD_RTOS_MAX_TASKS          (32)   //maximum number of running tasks (up to 256), idle task included
+#endif
+//#define BAD_RTOS_PRIO_COUNT       (8)    //number of priorities (up to 256), idle task running at BAD_RTOS_PRIO_COUNT-1, defaults to BAD_RTOS_MAX_TASKS
 #define BAD_RTOS_PRIO_BITS          (4)
+#define BAD_RTOS_IRQ_COUNT          (131)  //number of nvic lines, sizes the threaded irq table
 
 //set those to whatever name your hal sets them as WEAK
 #define BAD_RTOS_SVC_HANDLER_NAME svc_isr
@@ -958,12 +1582,35 @@
 
 #if BAD_RTOS_MAX_TASKS < 2
 #error "Number of tasks must be > 1 to accomodate for idle task"
-#elif BAD_RTOS_MAX_TASKS > 32
-#error "Number of tasks must be <=32"
+#elif BAD_RTOS_MAX_TASKS > 256
+#error "Number of tasks must be <=256"
 #endif
 
-// error codes 
-typedef enum {
+#ifndef BAD_RTOS_PRIO_COUNT
+#define BAD_RTOS_PRIO_COUNT BAD_RTOS_MAX_TASKS
+#endif
+
+#if BAD_RTOS_PRIO_COUNT < 2
+#error "Number of priorities must be > 1 to accomodate for idle task"
+#elif BAD_RTOS_PRIO_COUNT > 256
+#error "Number of priorities must be <=256"
+#endif
+
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+#ifndef BAD_RTOS_WAITQ_LEVELS
+#if BAD_RTOS_PRIO_COUNT < 8
+#define BAD_RTOS_WAITQ_LEVELS BAD_RTOS_PRIO_COUNT
+#else
+#define BAD_RTOS_WAITQ_LEVELS 8
+#endif
+#endif
+#if BAD_RTOS_WAITQ_LEVELS < 1 || BAD_RTOS_WAITQ_LEVELS > 32 || BAD_RTOS_WAITQ_LEVELS > BAD_RTOS_PRIO_COUNT
+#error "Wait queue index levels must be between 1 and 32 and no more than BAD_RTOS_PRIO_COUNT"
+#endif
+#endif
+
+// error codes 
+typedef enum {
     BAD_RTOS_STATUS_ALLOC_FAIL = 0, // to return as null ptr
     BAD_RTOS_STATUS_OK,
     BAD_RTOS_STATUS_BAD_PARAMETERS,
@@ -983,7 +1630,8 @@ typedef enum {
     BAD_RTOS_STATUS_ALREADY_BOUND,
     BAD_RTOS_STATUS_SCHED_LOCKED,
     BAD_RTOS_STATUS_FIRED,
-    BAD_RTOS_STATUS_IN_USE
+    BAD_RTOS_STATUS_IN_USE,
+    BAD_RTOS_STATUS_OVERRUN
 }bad_rtos_status_t;
 // helper enum to discriminate the position of the tcb in a queue
 // the logic behind it is
@@ -996,7 +1644,9 @@ typedef enum {
     BAD_RTOS_MISC_MUTEX_BLOCKEDQ_MEMBER,
     BAD_RTOS_MISC_SEM_BLOCKEDQ_MEMBER,
     BAD_RTOS_MISC_MSGQ_BLOCKEDQ_MEMBER,
-    BAD_RTOS_MISC_EVENT_BARRIER_BLOCKEDQ_MEMBER
+    BAD_RTOS_MISC_EVENT_BARRIER_BLOCKEDQ_MEMBER,
+    BAD_RTOS_MISC_NOTIFY_WAIT, //not a queue, task waits on its own notification word
+    BAD_RTOS_MISC_POOL_BLOCKEDQ_MEMBER
 } bad_rtos_misc_t;
 // helper enum for software timer queue
 // folows the same logic as the enum above
@@ -1023,6 +1673,32 @@ typedef struct bad_link_node{
     struct bad_link_node *next;
 } bad_link_node_t;
 
+// isr queue node, embedded in every object an isr can signal, queued at most once
+// signals arriving while it is queued are folded into pending and handled by one pendsv pass
+typedef struct bad_isr_node{
+    struct bad_isr_node * volatile next;
+    uint16_t op_kind; //bad_isr_op_t
+    volatile uint16_t pending; //or of the ops waiting for pendsv, non zero while the node sits in the isr queue
+    void *arg;
+}bad_isr_node_t;
+
+#ifdef BAD_RTOS_USE_COROUTINES
+// binding of a sem or msgq to the coroutine scheduler awaiting it, signal is claimed with ldrex/strex
+// so one host task holds it at a time, count is only touched by the host holding it
+typedef struct{
+    struct bad_sem * volatile signal; //put on every put or post, 0 while no coroutine awaits the object
+    uint32_t count; //coroutines of the scheduler in an await on the object
+}bad_coro_bind_t;
+#endif
+
+#ifdef BAD_RTOS_USE_TASK_NOTIFY
+typedef enum{
+    BAD_NOTIFY_SET_BITS, //value |= bits
+    BAD_NOTIFY_INCREMENT, //value += 1, bits ignored
+    BAD_NOTIFY_OVERWRITE //value = bits
+}bad_notify_action_t;
+#endif
+
 // main fat struct of the program
 typedef struct bad_tcb{
     // stack pointer, doesnt really reflect the actual one when running, actual one is + 32
@@ -1052,22 +1728,97 @@ typedef struct bad_tcb{
     //execution priority, follows nvic logic : lower number is higher priority
     uint8_t base_priority;
     uint8_t raised_priority;
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    uint8_t wait_priority; //priority the task was queued with, raised_priority may change while waiting
+#endif
 #ifdef BAD_RTOS_USE_MUTEX
     uint8_t mutex_count;
 #endif
 #ifdef BAD_RTOS_USE_MSGQ
     uint8_t msgq_owner;
 #endif
+#ifdef BAD_RTOS_USE_PERIODIC_TASKS
+    uint32_t period; //0 for non periodic tasks
+    uint32_t last_release;
+    uint32_t overruns;
+    uint32_t max_lateness;
+#endif
+#ifdef BAD_RTOS_USE_TASK_NOTIFY
+    volatile uint32_t notify_value;
+    volatile uint32_t notify_mask; //bits the task waits for, 0 if not waiting
+#endif
+    bad_isr_node_t isr_node; //unblock, delay cancel and notify from isrs, pending holds bad_isr_task_op_t bits
+#ifdef BAD_RTOS_USE_STACK_WATERMARK
+    uint32_t stack_untouched; //painted words at the bottom of the stack that were never written
+#endif
 }bad_tcb_t;
 
+#ifdef BAD_RTOS_USE_PERIODIC_TASKS
+typedef struct{
+    uint32_t period;
+    uint32_t overruns; //releases that already passed when the task asked for them
+    uint32_t max_lateness; //worst distance in ticks between a missed release and the call
+}bad_period_stats_t;
+#endif
+
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+// Wait queue index, follows blockedq in every synchro object 
+// the blockedq list stays priority sorted, the index just finds the insertion point
+// It is kept per level and not per priority so every sem, msgq, mutex and gpool block stays small
+typedef struct{
+    uint32_t bmask; //levels present in the wait queue
+    uint8_t tails[BAD_RTOS_WAITQ_LEVELS]; //tcb slab index of the last waiter of that level
+}bad_waitq_index_t;
+
+#define BAD_WAITQ_LEVEL(prio) ((uint32_t)(prio) * BAD_RTOS_WAITQ_LEVELS / BAD_RTOS_PRIO_COUNT)
+#endif
+
 typedef struct {
     uint8_t * volatile next;
     uint8_t *mem;
     volatile uint32_t curr;
     uint32_t size_in_bytes;
     uint32_t block_size;
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    volatile uint32_t in_use;
+    volatile uint32_t max_in_use; //high water mark
+    volatile uint32_t fails;
+#endif
+#ifdef BAD_RTOS_USE_POOL_WAIT
+    bad_link_node_t blockedq; //not first, the free list head has to be
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    bad_waitq_index_t waitq_index;
+#endif
+    bad_isr_node_t isr_node; //pool_free from isr wake
+#endif
 }bad_pool_t;
 
+#ifdef BAD_RTOS_USE_HEAP_STATS
+typedef struct{
+    uint32_t blocks; //capacity
+    uint32_t free;
+    uint32_t min_free; //fewest free blocks seen since pool_init
+    uint32_t fails; //allocations that found the pool empty, pool_alloc_wait calls that had to wait included
+}bad_pool_stats_t;
+
+typedef struct{
+#ifdef BAD_RTOS_USE_KHEAP
+    uint32_t kheap_size;
+    uint32_t kheap_free; //bytes
+    uint32_t kheap_min_free; //fewest free bytes seen since start
+    uint32_t kheap_largest_free; //biggest block a single kernel_alloc can get
+    uint32_t kheap_allocs;
+    uint32_t kheap_fails;
+#ifndef BAD_RTOS_USE_KHEAP_TLSF
+    uint16_t kheap_free_blocks[32]; //free blocks per order, block size is 1 << index
+#endif
+#endif
+    uint32_t tasks; //tcbs in use, idle included
+    uint32_t max_tasks; //most tcbs in use at once
+    bad_pool_stats_t gpool;
+}bad_mem_stats_t;
+#endif
+
 #ifdef BAD_RTOS_USE_MSGQ
 typedef struct bad_msg_block{
     uint32_t signal;
@@ -1076,13 +1827,24 @@ typedef struct bad_msg_block{
 
 typedef struct {
     bad_link_node_t blockedq;
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    bad_waitq_index_t waitq_index;
+#endif
     bad_tcb_t* owner;
+    volatile uint32_t writer; //tcb of the thread mode post holding the queue, 0 if none
+    volatile uint32_t boosted; //writer running on the owner priority until its commit, 0 if none
+    uint8_t boost_priority; //priority the boosted writer got from the owner
+    uint8_t boost_restore; //raised priority the boosted writer had before, restored on its commit
     uint16_t capacity;
-    uint16_t pad;
+    volatile uint16_t writing; //slot + 1 reserved by a thread mode post and not written yet, 0 if none
     volatile uint16_t head;
     volatile uint16_t tail;
     bad_msg_block_t *msgs;
     uint8_t dynamic;
+    bad_isr_node_t isr_node; //msgq_post_msg_from_isr consumer wake
+#ifdef BAD_RTOS_USE_COROUTINES
+    bad_coro_bind_t waitset;
+#endif
 } bad_msgq_t;
 #endif
 
@@ -1098,6 +1860,9 @@ typedef struct{
 #endif
 #ifdef BAD_RTOS_USE_MSGQ
     bad_msgq_t *assigned_msgq;
+#endif
+#ifdef BAD_RTOS_USE_PERIODIC_TASKS
+    uint32_t period; //release period in ticks for task_wait_period, 0 if not periodic
 #endif
     uint8_t base_priority;
 }bad_task_descr_t;
@@ -1105,27 +1870,102 @@ typedef struct{
 #ifdef BAD_RTOS_USE_MUTEX
 typedef struct bad_mutex{
     bad_link_node_t blockedq;
-    bad_tcb_t *owner;
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    bad_waitq_index_t waitq_index;
+#endif
+    volatile uint32_t owner; //owner tcb ptr | BAD_MUTEX_WAITERS, taken and put with ldrex/strex while uncontended
     uint32_t rec_takes;
 } bad_mutex_t ;
+
+#define BAD_MUTEX_WAITERS (0x1U) //set while the mutex is contended, forces put into the kernel
 #endif
 
 #ifdef BAD_RTOS_USE_SEMAPHORE
 typedef struct bad_sem{
     bad_link_node_t blockedq;
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    bad_waitq_index_t waitq_index;
+#endif
     volatile uint32_t counter;
     volatile uint32_t init_flag;
+    bad_isr_node_t isr_node; //sem_put_from_isr wake
+#ifdef BAD_RTOS_USE_COROUTINES
+    bad_coro_bind_t waitset;
+#endif
 } bad_sem_t;
 #endif
 
 #ifdef BAD_RTOS_USE_EVENT_BARRIER
 typedef struct{
     bad_link_node_t blockedq;
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    bad_waitq_index_t waitq_index;
+#endif
     volatile uint32_t flags;
     volatile uint32_t count;
+    bad_isr_node_t isr_node; //event_barrier_fire_from_isr wake
 }bad_event_barrier_t;
 #endif
 
+#if defined(BAD_RTOS_USE_WORKQ) || defined(BAD_RTOS_USE_BASIC_TASKS)
+typedef void (*bad_run_fn_t)(void *arg);
+
+// function and argument linked into a run queue through the isr node so queuing never allocates
+typedef struct bad_run_item{
+    bad_isr_node_t node; //arg is passed to fn, pending is set from the push until a runner picks the item
+    bad_run_fn_t fn;
+}bad_run_item_t;
+#endif
+
+#ifdef BAD_RTOS_USE_WORKQ
+typedef bad_run_fn_t bad_work_fn_t;
+typedef bad_run_item_t bad_work_t; //deferred work item
+#endif
+
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+typedef bad_run_fn_t bad_basic_fn_t;
+
+// run to completion task without a stack of its own, queued on the run queue of its level
+typedef struct bad_basic_task{
+    bad_run_item_t item;
+    uint32_t level;
+}bad_basic_task_t;
+#endif
+
+#ifdef BAD_RTOS_USE_COROUTINES
+typedef enum{
+    BAD_CORO_WAITING, //parked on an await whose condition is false
+    BAD_CORO_YIELDED, //runnable, resumed on the next pass
+    BAD_CORO_DONE
+}bad_coro_state_t;
+
+typedef enum{
+    BAD_CORO_WAIT_FOREVER,
+    BAD_CORO_WAIT_TIMED,
+    BAD_CORO_WAIT_NONE //poll once, delay UINT32_MAX
+}bad_coro_wait_t;
+
+typedef struct bad_coro bad_coro_t;
+typedef bad_coro_state_t (*bad_coro_fn_t)(bad_coro_t *coro);
+
+// wait set of one host task, awaited objects put the signal so the host only blocks on it
+typedef struct{
+    bad_sem_t signal;
+    bad_coro_t *head; //coroutines in spawn order, newest first
+}bad_coro_sched_t;
+
+struct bad_coro{
+    bad_coro_t *next;
+    bad_coro_fn_t fn;
+    void *arg;
+    bad_coro_sched_t *sched;
+    bad_coro_bind_t *bound; //binding of the object the current await holds
+    uint32_t deadline; //low tick word the current await times out at
+    uint16_t line; //resume point, 0 before the first run
+    uint16_t wait; //bad_coro_wait_t of the current await
+};
+#endif
+
 #ifdef BAD_RTOS_USE_MPU
 
 typedef enum{
@@ -1221,6 +2061,16 @@ extern bad_rtos_status_t task_yield();
 extern bad_rtos_status_t task_finish();
 extern bad_rtos_status_t task_delay_cancel(bad_task_handle_t task);
 extern bad_rtos_status_t task_delay_cancel_from_isr(bad_task_handle_t task);
+#ifdef BAD_RTOS_USE_PERIODIC_TASKS
+extern bad_rtos_status_t task_delay_until(uint32_t *last_wake, uint32_t period);
+extern bad_rtos_status_t task_wait_period();
+extern bad_rtos_status_t task_period_stats(bad_task_handle_t task, bad_period_stats_t *stats);
+#endif
+#ifdef BAD_RTOS_USE_TASK_NOTIFY
+extern bad_rtos_status_t task_notify(bad_task_handle_t task, uint32_t bits, bad_notify_action_t action);
+extern bad_rtos_status_t task_notify_from_isr(bad_task_handle_t task, uint32_t bits, bad_notify_action_t action);
+extern bad_rtos_status_t task_notify_wait(uint32_t mask, uint32_t delay, uint32_t *value);
+#endif
 extern uint32_t sched_lock();
 extern void sched_unlock(uint32_t key);
 extern bad_rtos_status_t pool_init(bad_pool_t *pool, void *mem, uint32_t block_size, uint32_t size_in_bytes);
@@ -1229,11 +2079,62 @@ extern void pool_free(bad_pool_t *pool, void *obj);
 extern void* gpool_alloc();
 extern void gpool_free(void *obj);
 
+#ifdef BAD_RTOS_USE_STACK_WATERMARK
+typedef struct{
+    bad_task_handle_t handle; //BAD_STACK_MSP for the exception stack
+    uint32_t size; //bytes
+    uint32_t used; //deepest use so far in bytes
+    uint32_t recommended; //bytes
+}bad_stack_stats_t;
+
+typedef void (*bad_putc_t)(char c);
+
+#define BAD_STACK_MSP ((bad_task_handle_t)BAD_RTOS_MAX_TASKS) //no task has this index
+
+extern bad_rtos_status_t stack_stats(bad_task_handle_t handle, bad_stack_stats_t *stats);
+extern void stack_report(bad_putc_t putc);
+extern void semihost_putc(char c);
+#endif
+
+#ifdef BAD_RTOS_USE_POOL_WAIT
+extern void* pool_alloc_wait(bad_pool_t *pool, uint32_t delay);
+#endif
+
+#ifdef BAD_RTOS_USE_HEAP_STATS
+extern bad_rtos_status_t pool_stats(bad_pool_t *pool, bad_pool_stats_t *stats);
+extern bad_rtos_status_t kernel_mem_stats(bad_mem_stats_t *stats);
+#endif
+
 #ifdef BAD_RTOS_USE_KHEAP
 extern void* kernel_alloc(uint32_t size);
 extern void kernel_free(void *block,uint32_t size);
 #endif
 
+#ifdef BAD_RTOS_USE_KHEAP_ARENAS
+#ifndef BAD_RTOS_USE_KHEAP_TLSF
+#error "Kernel heap arenas need BAD_RTOS_USE_KHEAP_TLSF, bank sizes come from the linker and the buddy needs power of two heaps"
+#endif
+typedef uint32_t bad_kheap_policy_t;
+
+//Heap arena policies, arenas are numbered in the order of kheap_banks
+#define BAD_KHEAP_FASTEST_FIRST     (0)
+#define BAD_KHEAP_BANK(arena)       (0xFFFFFFF0U | (arena))
+#define BAD_KHEAP_CHAIN(first,second) (0xFFFFFF00U | ((second) << 4) | (first))
+#define BAD_KHEAP_CHAIN3(first,second,third) (0xFFFFF000U | ((third) << 8) | ((second) << 4) | (first))
+
+extern void* kernel_alloc_from(uint32_t size, bad_kheap_policy_t policy);
+#endif
+
+#ifdef BAD_RTOS_USE_SLAB
+extern void* slab_alloc(uint32_t size);
+extern void slab_free(void *obj, uint32_t size);
+#endif
+
+#ifdef BAD_RTOS_USE_SHARED_TIME
+extern uint64_t kernel_ticks64();
+extern uint64_t kernel_timestamp();
+#endif
+
 #ifdef BAD_RTOS_USE_MUTEX
 extern bad_rtos_status_t mutex_init(bad_mutex_t *mut);
 extern bad_rtos_status_t mutex_take(bad_mutex_t *mut,uint32_t delay);
@@ -1277,45 +2178,150 @@ extern bad_rtos_status_t event_barrier_fire(bad_event_barrier_t *event_barrier,
 extern bad_rtos_status_t event_barrier_delete(bad_event_barrier_t *event_barrier);
 #endif
 
+#ifdef BAD_RTOS_USE_WORKQ
+//Macro for static work item definition
+#define WORK_STATIC_INIT(name,work_fn,work_arg)\
+bad_work_t name = {.node = {.arg = (work_arg)},.fn = (work_fn)};
+
+extern bad_rtos_status_t work_submit_from_isr(bad_work_t *work);
+extern void work_worker(void *unused);
+#endif
+
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+//Macro for static basic task definition
+#define BASIC_TASK_STATIC_INIT(name,task_fn,task_arg,task_level)\
+bad_basic_task_t name = {.item = {.node = {.arg = (task_arg)},.fn = (task_fn)},.level = (task_level)};
+
+extern bad_rtos_status_t basic_task_activate(bad_basic_task_t *task);
+extern void basic_runner(void *level);
+#endif
+
+#ifdef BAD_RTOS_USE_COROUTINES
+// Resume points are case labels on source lines (protothreads), one await per line
+#define CORO_BEGIN(coro) switch((coro)->line){ case 0:
+#define CORO_END(coro) } coro_unbind(coro); (coro)->line = 0; return BAD_CORO_DONE;
+#define CORO_YIELD(coro) do{ (coro)->line = __LINE__; return BAD_CORO_YIELDED; case __LINE__:; }while(0)
+#define CORO_WAIT_UNTIL(coro,cond) do{ (coro)->line = __LINE__; case __LINE__: if(!(cond)){ return BAD_CORO_WAITING; } (coro)->wait = BAD_CORO_WAIT_FOREVER; }while(0)
+#define CORO_DELAY(coro,ticks) do{ coro_sleep_start((coro),(ticks)); CORO_WAIT_UNTIL((coro),coro_expired(coro)); }while(0)
+#define CORO_SEM_TAKE(coro,sem,delay,status) do{ coro_wait_start((coro),(delay)); CORO_WAIT_UNTIL((coro),coro_sem_poll((coro),(sem),&(status))); }while(0)
+#define CORO_MSGQ_PULL(coro,q,writeback,delay,status) do{ coro_wait_start((coro),(delay)); CORO_WAIT_UNTIL((coro),coro_msgq_poll((coro),(q),(writeback),&(status))); }while(0)
+
+extern bad_rtos_status_t coro_sched_init(bad_coro_sched_t *sched);
+extern bad_rtos_status_t coro_spawn(bad_coro_sched_t *sched, bad_coro_t *coro, bad_coro_fn_t fn, void *arg);
+extern void coro_sched_run(bad_coro_sched_t *sched);
+// used by the await macros
+extern void coro_wait_start(bad_coro_t *coro, uint32_t delay);
+extern void coro_sleep_start(bad_coro_t *coro, uint32_t ticks);
+extern uint32_t coro_expired(bad_coro_t *coro);
+extern void coro_unbind(bad_coro_t *coro);
+extern uint32_t coro_sem_poll(bad_coro_t *coro, bad_sem_t *sem, bad_rtos_status_t *status);
+#ifdef BAD_RTOS_USE_MSGQ
+extern uint32_t coro_msgq_poll(bad_coro_t *coro, bad_msgq_t *q, bad_msg_block_t *writeback, bad_rtos_status_t *status);
+#endif
+#endif
+
+#ifdef BAD_RTOS_USE_THREADED_IRQ
+//Macro for the vector of a threaded line
+#define THREADED_IRQ_HANDLER(isr_name)\
+void isr_name(void){ irq_thread_isr(); }
+
+extern void irq_thread_isr(void);
+extern bad_rtos_status_t irq_thread_register(uint32_t irqn, bad_task_handle_t task);
+extern bad_rtos_status_t irq_thread_wait(uint32_t irqn);
+#endif
+
 #ifdef BAD_RTOS_IMPLEMENTATION
 
-#define BAD_RTOS_PRIO_COUNT BAD_RTOS_MAX_TASKS
+#define BAD_RTOS_WHEEL_SLOTS 32 //one slot per bit of the occupancy mask
+// Past 32 the bitmaps become two level, a summary word with one bit per non empty leaf word
+#define BAD_RTOS_PRIO_WORDS ((BAD_RTOS_PRIO_COUNT + 31) / 32)
+#define BAD_RTOS_TASK_WORDS ((BAD_RTOS_MAX_TASKS + 31) / 32)
 typedef enum {
     BAD_ISR_OP_MSGQ_WAKE,
     BAD_ISR_OP_SEM_PUT,
-    BAD_ISR_OP_TASK_DELAY_CANCEL,
-    BAD_ISR_OP_TASK_UNBLOCK,
-    BAD_ISR_OP_EVENT_BARRIER_WAKE
+    BAD_ISR_OP_TASK,
+    BAD_ISR_OP_EVENT_BARRIER_WAKE,
+    BAD_ISR_OP_POOL_WAKE
 }bad_isr_op_t;
 
-typedef struct bad_isr_op_obj{
-    struct bad_isr_op_obj * volatile next;
-    bad_isr_op_t op_kind;
-    void *arg;
-    uint32_t pad;
-}bad_isr_op_obj_t;
+// pending bits of the tcb node
+typedef enum {
+    BAD_ISR_TASK_NOTIFY = 0x1,
+    BAD_ISR_TASK_UNBLOCK = 0x2,
+    BAD_ISR_TASK_DELAY_CANCEL = 0x4
+}bad_isr_task_op_t;
+
+// global pool block, one fits any synchro object except message queues
+typedef union{
+    bad_link_node_t blockedq; //keeps the union valid with every synchro object disabled
+#ifdef BAD_RTOS_USE_MUTEX
+    bad_mutex_t mutex;
+#endif
+#ifdef BAD_RTOS_USE_SEMAPHORE
+    bad_sem_t sem;
+#endif
+#ifdef BAD_RTOS_USE_EVENT_BARRIER
+    bad_event_barrier_t event_barrier;
+#endif
+}bad_gpool_block_t;
 
 typedef struct {
-    bad_isr_op_obj_t * volatile tail;
-    bad_isr_op_obj_t * volatile head;
-    bad_isr_op_obj_t stub;
+    bad_isr_node_t * volatile tail;
+    bad_isr_node_t * volatile head;
+    bad_isr_node_t stub;
 }bad_isr_q_t;
 
+#if defined(BAD_RTOS_USE_WORKQ) || defined(BAD_RTOS_USE_BASIC_TASKS)
+// run items plus one semaphore permit per push, drained by runner tasks
+typedef struct {
+    bad_isr_q_t q;
+    bad_sem_t sem;
+}bad_run_q_t;
+
+typedef bad_run_item_t *(*bad_run_pop_t)(bad_run_q_t *rq);
+#endif
+
 typedef struct {
     volatile uint32_t ticks;
     bad_tcb_t * volatile curr;
     bad_tcb_t * volatile next;
+#ifdef BAD_RTOS_USE_TIMING_WHEEL
+    uint32_t wheel_bmask; //occupied wheel slots, tick handler checks this one
+    uint32_t wheel_last; //last tick the wheel was scanned at
+#else
     bad_link_node_t delayq;
+#endif
     uint8_t is_running;
     uint8_t is_unlocked;
-    uint32_t ready_bmask;
+#ifdef BAD_RTOS_USE_TICKLESS_IDLE
+    uint8_t is_tickless; //tick handler checks this one, keep it in the padding
+#endif
+    uint32_t ready_bmask; //with more than 32 priorities this is the summary of ready_leaf
+#ifdef BAD_RTOS_USE_MPU
+    const mpu_region_t *mpu_loaded; //task region set currently in the mpu, context switch checks this one
+#endif
+#if BAD_RTOS_PRIO_COUNT > 32
+    uint32_t ready_leaf[BAD_RTOS_PRIO_WORDS];
+#endif
     bad_link_node_t readyq[BAD_RTOS_PRIO_COUNT];
     bad_link_node_t blockedq;
     bad_isr_q_t isrq;
+#ifdef BAD_RTOS_USE_TICKLESS_IDLE
+    uint32_t tickless_reload; //systick cycles per tick
+    uint32_t tickless_offset; //cycles into the current tick when the tick was stopped
+#endif
+#ifdef BAD_RTOS_USE_TIMING_WHEEL
+    bad_link_node_t wheel[BAD_RTOS_WHEEL_SLOTS];
+#endif
 }bad_kernel_cb_t;
 
 typedef struct bitmask_slab_cb{
+#if BAD_RTOS_MAX_TASKS > 32
+    uint32_t free_summary;
+    uint32_t free_bitmask[BAD_RTOS_TASK_WORDS];
+#else
     uint32_t free_bitmask;
+#endif
     bad_tcb_t node_arr[BAD_RTOS_MAX_TASKS];
 } tcb_bitmask_slab_t;
 
@@ -1327,21 +2333,105 @@ typedef enum {
 
 static bad_kernel_cb_t __attribute__((section(".kernel_bss"))) kernel_cb;
 
-static tcb_bitmask_slab_t __attribute__((section(".kernel_bss"))) tcbslab;
+// Copy of kernel_cb.curr written on every context switch, not in .kernel_bss on purpose, 
+// lets the thread mode fast paths know who they are running as
+static bad_tcb_t * volatile __attribute__((used)) shared_curr;
 
-#define BAD_RTOS_GLOBAL_POOL_SIZE_IN_BYTES (BAD_RTOS_GLOBAL_POOL_SIZE * sizeof(bad_isr_op_obj_t))
+#ifdef BAD_RTOS_USE_TICKLESS_IDLE
+_Static_assert(__builtin_offsetof(bad_kernel_cb_t,is_tickless) == 22,"Tick handler expects is_tickless at offset 22");
+#endif
+
+#ifdef BAD_RTOS_USE_TIMING_WHEEL
+_Static_assert(__builtin_offsetof(bad_kernel_cb_t,wheel_bmask) == 12,"Tick handler expects wheel_bmask at offset 12");
+#endif
+
+#ifdef BAD_RTOS_USE_MPU
+_Static_assert(__builtin_offsetof(bad_kernel_cb_t,mpu_loaded) == 28,"Context switch expects mpu_loaded at offset 28");
+#endif
+
+#ifdef BAD_RTOS_USE_SHARED_TIME
+typedef struct{
+    volatile uint32_t ticks_lo; //copy of kernel_cb.ticks
+    volatile uint32_t ticks_hi;
+}bad_shared_time_t;
+
+// Not in .kernel_bss on purpose, tasks read it directly
+static bad_shared_time_t shared_time;
+
+_Static_assert(__builtin_offsetof(bad_shared_time_t,ticks_hi) == 4,"Tick handler expects ticks_hi at offset 4");
+#endif
+
+#ifdef BAD_RTOS_USE_WORKQ
+#ifndef BAD_RTOS_USE_SEMAPHORE
+#error "Deferred work needs BAD_RTOS_USE_SEMAPHORE"
+#endif
+// Not in .kernel_bss, isrs push without opening the kernel region
+// items are popped in the kernel so any number of workers can share the queue
+static bad_run_q_t kernel_workq; //one permit per submitted item
+#endif
+
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+#ifndef BAD_RTOS_USE_SEMAPHORE
+#error "Basic tasks need BAD_RTOS_USE_SEMAPHORE"
+#endif
+#ifndef BAD_RTOS_BASIC_LEVELS
+#define BAD_RTOS_BASIC_LEVELS (2)
+#endif
+// Not in .kernel_bss, isrs and tasks push without opening the kernel region
+// each queue has a single consumer (its runner) so it is popped in thread mode without an svc
+typedef struct{
+    bad_run_q_t rq; //one permit per activation, the runner drains the queue on any of them
+    bad_tcb_t * volatile running; //runner tcb while a basic task runs, blocking calls fail for it
+}bad_basic_level_t;
+
+static bad_basic_level_t basic_levels[BAD_RTOS_BASIC_LEVELS];
+#endif
 
-_Static_assert( 1
 #ifdef BAD_RTOS_USE_MUTEX
-               && sizeof(bad_isr_op_obj_t) == sizeof(bad_mutex_t)
+// Mutexes each task owns, contended or not, tcb->mutex_count only sees the contended ones
+// Not in .kernel_bss, the thread mode take and put count their own entry
+static volatile uint32_t mutex_holds[BAD_RTOS_MAX_TASKS];
 #endif
-#ifdef BAD_RTOS_USE_SEMAPHORE
-               && sizeof(bad_isr_op_obj_t) == sizeof(bad_sem_t)
+
+#ifdef BAD_RTOS_USE_COROUTINES
+#if !defined(BAD_RTOS_USE_SEMAPHORE) || !defined(BAD_RTOS_USE_SHARED_TIME)
+#error "Coroutines need BAD_RTOS_USE_SEMAPHORE and BAD_RTOS_USE_SHARED_TIME"
 #endif
-#ifdef BAD_RTOS_USE_EVENT_BARRIER
-               && sizeof(bad_isr_op_obj_t) == sizeof(bad_event_barrier_t)
 #endif
-               ,"What have i done #1");
+
+#ifdef BAD_RTOS_USE_THREADED_IRQ
+// handler task per nvic line, isrs only read it
+static bad_task_handle_t __attribute__((section(".kernel_bss"))) irq_threads[BAD_RTOS_IRQ_COUNT];
+#endif
+
+#ifdef BAD_RTOS_USE_TICKLESS_IDLE
+#ifndef BAD_RTOS_TICKLESS_MIN_IDLE_TICKS
+#define BAD_RTOS_TICKLESS_MIN_IDLE_TICKS 2
+#elif BAD_RTOS_TICKLESS_MIN_IDLE_TICKS < 2
+#error "Tickless idle needs at least 2 ticks to be worth it"
+#endif
+#endif
+
+static tcb_bitmask_slab_t __attribute__((section(".kernel_bss"))) tcbslab;
+
+#ifdef BAD_RTOS_USE_HEAP_STATS
+// Kernel side memory counters, only touched inside svcs
+typedef struct{
+#ifdef BAD_RTOS_USE_KHEAP
+    uint32_t kheap_size;
+    uint32_t kheap_free;
+    uint32_t kheap_min_free;
+    uint32_t kheap_allocs;
+    uint32_t kheap_fails;
+#endif
+    uint32_t tasks;
+    uint32_t max_tasks;
+}bad_kmem_counters_t;
+
+static bad_kmem_counters_t __attribute__((section(".kernel_bss"))) kmem_counters;
+#endif
+
+#define BAD_RTOS_GLOBAL_POOL_SIZE_IN_BYTES (BAD_RTOS_GLOBAL_POOL_SIZE * sizeof(bad_gpool_block_t))
 
 _Static_assert( 1
 #ifdef BAD_RTOS_USE_MUTEX
@@ -1358,8 +2448,71 @@ _Static_assert( 1
 #endif
                ,"What have i done #2");
 
-static uint8_t  __attribute__((aligned(_Alignof(bad_isr_op_obj_t)))) gpool_mem[BAD_RTOS_GLOBAL_POOL_SIZE_IN_BYTES];
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+_Static_assert( 1
+#ifdef BAD_RTOS_USE_MUTEX
+               && __builtin_offsetof(bad_mutex_t,waitq_index) == sizeof(bad_link_node_t)
+#endif
+#ifdef BAD_RTOS_USE_MSGQ
+               && __builtin_offsetof(bad_msgq_t,waitq_index) == sizeof(bad_link_node_t)
+#endif
+#ifdef BAD_RTOS_USE_SEMAPHORE
+               && __builtin_offsetof(bad_sem_t,waitq_index) == sizeof(bad_link_node_t)
+#endif
+#ifdef BAD_RTOS_USE_EVENT_BARRIER
+               && __builtin_offsetof(bad_event_barrier_t,waitq_index) == sizeof(bad_link_node_t)
+#endif
+               ,"What have i done #3");
+
+#define BAD_WAITQ_INDEX(q) ((bad_waitq_index_t *)((q) + 1))
+#endif
+
+static uint8_t  __attribute__((aligned(_Alignof(bad_gpool_block_t)))) gpool_mem[BAD_RTOS_GLOBAL_POOL_SIZE_IN_BYTES];
 static bad_pool_t gpool;
+
+#ifdef BAD_RTOS_USE_SLAB
+#ifndef BAD_RTOS_USE_KHEAP
+#error "Slab caches need BAD_RTOS_USE_KHEAP"
+#endif
+
+#ifndef BAD_RTOS_SLAB_PAGE_SIZE
+#define BAD_RTOS_SLAB_PAGE_SIZE (512)
+#elif BAD_RTOS_SLAB_PAGE_SIZE < 512
+#error "Slab page must hold at least one object of the biggest class"
+#endif
+
+#define BAD_SLAB_MIN_ORDER 3 //8 bytes, enough for the free list link
+#define BAD_SLAB_MAX_ORDER 9
+#define BAD_SLAB_CLASS_COUNT (BAD_SLAB_MAX_ORDER - BAD_SLAB_MIN_ORDER + 1)
+
+// Free list heads of the size classes, not in .kernel_bss so tasks pull and push without an svc
+static uint8_t * volatile slab_heads[BAD_SLAB_CLASS_COUNT];
+#endif
+
+#ifdef BAD_RTOS_USE_KHEAP_MAGAZINES
+#ifndef BAD_RTOS_USE_KHEAP
+#error "Heap magazines need BAD_RTOS_USE_KHEAP"
+#endif
+
+#ifndef BAD_RTOS_MAGAZINE_ORDERS
+#define BAD_RTOS_MAGAZINE_ORDERS (3)
+#endif
+
+#ifndef BAD_RTOS_MAGAZINE_SIZE
+#define BAD_RTOS_MAGAZINE_SIZE (4)
+#elif BAD_RTOS_MAGAZINE_SIZE < 2 || BAD_RTOS_MAGAZINE_SIZE > 255
+#error "Magazine size must be in 2..255"
+#endif
+
+typedef struct{
+    uint8_t count[BAD_RTOS_MAGAZINE_ORDERS];
+    void *rounds[BAD_RTOS_MAGAZINE_ORDERS][BAD_RTOS_MAGAZINE_SIZE];
+}bad_magazine_t;
+
+// One per tcb slot, only the owning task touches its magazine in thread mode
+// and the kernel flushes it when the task finishes, so no atomics are needed
+static bad_magazine_t task_magazines[BAD_RTOS_MAX_TASKS];
+#endif
 #ifdef BAD_RTOS_USE_KHEAP
 
 typedef struct {
@@ -1369,7 +2522,19 @@ typedef struct {
     uint32_t min_order;
     bad_link_node_t* free_list;
     uint32_t* bmask;
+#ifdef BAD_RTOS_USE_KHEAP_LAZY_MERGE
+    uint32_t pending_bmask; //free list indices that may hold a pair of free buddies
+#endif
 }bad_buddy_t;
+
+#ifdef BAD_RTOS_USE_KHEAP_LAZY_MERGE
+#ifdef BAD_RTOS_USE_KHEAP_TLSF
+#error "Lazy merging is a buddy mode, the tlsf heap already coalesces in O(1)"
+#endif
+#ifndef BAD_RTOS_KHEAP_MERGE_BATCH
+#define BAD_RTOS_KHEAP_MERGE_BATCH (16)
+#endif
+#endif
 #define BUDDY_BITMASK_SIZE(max_order,min_order)\
 (((1 << (max_order - min_order))-1)+31) >> 5 // bits required = (2 ^ max_order - min_order) - 1, to get the words divide by 32 and round up 
 
@@ -1388,6 +2553,89 @@ typedef struct {
 #error "Its called max order for a reason"
 #endif
 #endif 
+#ifdef BAD_RTOS_USE_KHEAP_TLSF
+
+#ifndef KHEAP_TLSF_MAX_ORDER
+#ifdef BAD_RTOS_USE_KHEAP_ARENAS
+#define KHEAP_TLSF_MAX_ORDER 18 //the sram3 arena of stm32h562vgt6_arenas.ld is 256k
+#else
+#define KHEAP_TLSF_MAX_ORDER KMAX_ORDER
+#endif
+#endif
+
+#ifndef KHEAP_SIZE
+#define KHEAP_SIZE (1<<KMAX_ORDER)
+#endif
+#if KHEAP_SIZE > (1<<KHEAP_TLSF_MAX_ORDER)
+#error "Tlsf heap must fit in 1 << KHEAP_TLSF_MAX_ORDER"
+#endif
+
+#ifndef KHEAP_ALIGN_LOG2
+#define KHEAP_ALIGN_LOG2 5 //mpu v8 regions are 32 byte granular, keeps dynamic stacks mappable
+#elif KHEAP_ALIGN_LOG2 < 3
+#error "Tlsf alignment must be >= 8 bytes to keep block headers aligned"
+#endif
+
+#if defined(BAD_RTOS_USE_MPU) && KHEAP_ALIGN_LOG2 < 5
+#error "Dynamic stacks need KHEAP_ALIGN_LOG2 >= 5 with the mpu, stack regions are 32 byte aligned"
+#endif
+
+#ifndef KHEAP_TLSF_SL_LOG2
+#define KHEAP_TLSF_SL_LOG2 4
+#endif
+
+#define KHEAP_ALIGN (1 << KHEAP_ALIGN_LOG2)
+#define KHEAP_TLSF_SL_COUNT (1 << KHEAP_TLSF_SL_LOG2)
+#define KHEAP_TLSF_FL_SHIFT (KHEAP_TLSF_SL_LOG2 + KHEAP_ALIGN_LOG2) // blocks below 1 << shift are split linearly in first level 0
+#define KHEAP_TLSF_FL_COUNT (KHEAP_TLSF_MAX_ORDER - KHEAP_TLSF_FL_SHIFT + 2)
+
+#if KHEAP_TLSF_FL_COUNT < 2 || KHEAP_TLSF_FL_COUNT > 31
+#error "KHEAP_TLSF_MAX_ORDER doesnt fit the tlsf class layout, check KHEAP_ALIGN_LOG2 and KHEAP_TLSF_SL_LOG2"
+#endif
+
+// physical neighbours are walked through size and prev_phys, free list links live in the payload
+typedef struct bad_tlsf_block{
+    struct bad_tlsf_block *prev_phys; //valid only while the previous block is free
+    uint32_t size;                    //whole block with the header, low bits are flags
+    struct bad_tlsf_block *next_free;
+    struct bad_tlsf_block *prev_free;
+}bad_tlsf_block_t;
+
+typedef struct{
+    uint32_t fl_bmask;
+    uint32_t sl_bmask[KHEAP_TLSF_FL_COUNT];
+    bad_tlsf_block_t *heads[KHEAP_TLSF_FL_COUNT][KHEAP_TLSF_SL_COUNT];
+}bad_tlsf_t;
+
+#define BAD_TLSF_HDR_SIZE   (__builtin_offsetof(bad_tlsf_block_t,next_free))
+#define BAD_TLSF_MIN_BLOCK  ((sizeof(bad_tlsf_block_t) + KHEAP_ALIGN - 1) & ~(KHEAP_ALIGN - 1))
+
+static uint8_t __attribute__((section(".kheap"),aligned(KHEAP_ALIGN))) kheap[KHEAP_SIZE];
+#ifdef BAD_RTOS_USE_KHEAP_ARENAS
+#ifndef BAD_RTOS_KHEAP_BANKS
+// banks from stm32h562vgt6_arenas.ld, sram2 then sram3
+extern uint8_t __heap_sram2;
+extern uint8_t __eheap_sram2;
+extern uint8_t __heap_sram3;
+extern uint8_t __eheap_sram3;
+#define BAD_RTOS_KHEAP_BANKS {&__heap_sram2,&__eheap_sram2},{&__heap_sram3,&__eheap_sram3}
+#endif
+
+typedef struct{
+    uint8_t *start;
+    uint8_t *end;
+}bad_kheap_bank_t;
+
+// arena 0 is kheap, then the extra banks, fastest first
+static const bad_kheap_bank_t kheap_banks[] = {{kheap, kheap + KHEAP_SIZE}, BAD_RTOS_KHEAP_BANKS};
+#define BAD_RTOS_KHEAP_ARENA_COUNT (sizeof(kheap_banks)/sizeof(kheap_banks[0]))
+_Static_assert(BAD_RTOS_KHEAP_ARENA_COUNT < 16, "Heap policies index arenas with 4 bits");
+
+static bad_tlsf_t __attribute__((section(".kernel_bss"))) kernel_arenas[BAD_RTOS_KHEAP_ARENA_COUNT];
+#else
+static bad_tlsf_t __attribute__((section(".kernel_bss"))) kernel_tlsf;
+#endif
+#else
 #define KHEAP_SIZE 1<<KMAX_ORDER
 #define KFREE_LIST_SIZE (KMAX_ORDER-KMIN_ORDER+1)
 
@@ -1396,6 +2644,7 @@ static bad_buddy_t __attribute__((section(".kernel_bss")))kernel_buddy;
 static bad_link_node_t __attribute__((section(".kernel_bss"))) kfreelist[KFREE_LIST_SIZE];
 static uint32_t __attribute__((section(".kernel_bss"))) kbitmask[BUDDY_BITMASK_SIZE(KMAX_ORDER, KMIN_ORDER)]; 
 #endif
+#endif
 
 #define IDLE_TASK_PRIO BAD_RTOS_PRIO_COUNT-1
 #define IDLE_TASK_STACK_SIZE 128
@@ -1410,6 +2659,46 @@ extern bad_rtos_status_t __svc_sem_take(bad_sem_t *sem,uint32_t delay);
 extern bad_rtos_status_t __svc_sem_put(bad_sem_t *sem);
 #endif
 
+#ifdef BAD_RTOS_USE_MUTEX
+extern bad_rtos_status_t __svc_mutex_take(bad_mutex_t *mut,uint32_t delay);
+extern bad_rtos_status_t __svc_mutex_put(bad_mutex_t *mut);
+#endif
+
+#ifdef BAD_RTOS_USE_MSGQ
+extern bad_rtos_status_t __svc_msgq_post_msg(bad_msgq_t *q, uint32_t signal, void *args, uint32_t delay);
+extern bad_rtos_status_t __svc_msgq_pull_msg(bad_msgq_t *q, bad_msg_block_t *writeback, uint32_t delay);
+extern void __svc_msgq_commit(bad_msgq_t *q);
+#endif
+
+#ifdef BAD_RTOS_USE_WORKQ
+extern bad_work_t* __svc_work_take();
+#endif
+
+#ifdef BAD_RTOS_USE_STACK_WATERMARK
+extern bad_rtos_status_t __svc_stack_stats(uint32_t slot, bad_stack_stats_t *stats);
+#endif
+
+#ifdef BAD_RTOS_USE_POOL_WAIT
+extern void* __svc_pool_alloc_wait(bad_pool_t *pool, uint32_t delay);
+extern void __svc_pool_free(bad_pool_t *pool, void *obj);
+static void __kernel_notify(bad_isr_node_t *node, bad_isr_op_t op, void *arg, uint16_t ops);
+#endif
+
+#if defined(BAD_RTOS_USE_COROUTINES) && defined(BAD_RTOS_USE_MSGQ)
+static bad_rtos_status_t __sem_put(bad_sem_t *sem); //msgq posts signal the waitset from the kernel
+#endif
+
+#ifdef BAD_RTOS_USE_SLAB
+extern void* __svc_slab_refill(uint32_t size_class);
+#endif
+
+#ifdef BAD_RTOS_USE_KHEAP_MAGAZINES
+extern void* __svc_kernel_alloc(uint32_t size);
+extern void __svc_kernel_free(void *block, uint32_t size);
+extern uint32_t __svc_kernel_alloc_batch(uint32_t order, void **rounds, uint32_t count);
+extern void __svc_kernel_free_batch(uint32_t order, void **rounds, uint32_t count);
+#endif
+
 static inline uint32_t __attribute__((always_inline)) __get_ipsr();
 static inline uint32_t __attribute__((always_inline)) __modify_basepri(uint32_t basepri);
 static inline void __attribute__((always_inline)) __restore_basepri(uint32_t basepri);
@@ -1450,6 +2739,10 @@ extern uint8_t __rkernel_data;
 
 extern uint8_t __static_stacks;
 
+#ifdef BAD_RTOS_USE_STACK_WATERMARK
+extern uint8_t __estack;
+#endif
+
 extern uint8_t __heap;
 
 extern uint8_t __dma_buffs;
@@ -1540,13 +2833,50 @@ BAD_RTOS_STATIC void __scb_trigger_pendsv(){
     BAD_SCB->ICSR = BAD_SCB_ICSR_PENDSVSET;
 }
 
-BAD_RTOS_STATIC void __scb_set_core_interrupt_priority(bad_scb_core_interrupt_t intr, bad_scb_interrupt_priority_t prio){
-    BAD_SCB->SHP[intr] = prio << (8 - BAD_RTOS_PRIO_BITS);
+#ifdef BAD_RTOS_USE_THREADED_IRQ
+typedef struct{
+    volatile uint32_t ISER[16];
+    uint32_t RESERVED0[16];
+    volatile uint32_t ICER[16];
+}bad_nvic_typedef_t;
+
+#define BAD_NVIC ((bad_nvic_typedef_t *) 0xE000E100UL)
+
+BAD_RTOS_STATIC void __nvic_enable_irq(uint32_t irqn){
+    BAD_NVIC->ISER[irqn >> 5] = 1U << (irqn & 0x1F);
 }
 
-BAD_RTOS_STATIC void __scb_set_fpu_permission_level(bad_scb_fpu_permission_t perms){
-    BAD_SCB->CPACR &= ~(BAD_SCB_CPACR_FPU_MASK);
-    BAD_SCB->CPACR |= perms << BAD_SCB_CPACR_FPU_SHIFT;
+BAD_RTOS_STATIC void __nvic_disable_irq(uint32_t irqn){
+    BAD_NVIC->ICER[irqn >> 5] = 1U << (irqn & 0x1F);
+    __dsb();
+    __isb(); //the line must not fire again once this returns
+}
+#endif
+
+#define BAD_SCB_ICSR_PENDSTCLR                  (0x1U << 25U)
+#define BAD_SCB_ICSR_PENDSTSET                  (0x1U << 26U)
+
+typedef struct{
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    volatile uint32_t VAL;
+    volatile uint32_t CALIB;
+}bad_systick_typedef_t;
+
+#define BAD_SYSTICK_BASE (0xE000E010UL)
+#define BAD_SYSTICK ((bad_systick_typedef_t *)BAD_SYSTICK_BASE)
+
+#define BAD_SYSTICK_CTRL_ENABLE     (0x1)
+#define BAD_SYSTICK_CTRL_COUNTFLAG  (0x10000)
+#define BAD_SYSTICK_MAX_LOAD        (0x1000000)
+
+BAD_RTOS_STATIC void __scb_set_core_interrupt_priority(bad_scb_core_interrupt_t intr, bad_scb_interrupt_priority_t prio){
+    BAD_SCB->SHP[intr] = prio << (8 - BAD_RTOS_PRIO_BITS);
+}
+
+BAD_RTOS_STATIC void __scb_set_fpu_permission_level(bad_scb_fpu_permission_t perms){
+    BAD_SCB->CPACR &= ~(BAD_SCB_CPACR_FPU_MASK);
+    BAD_SCB->CPACR |= perms << BAD_SCB_CPACR_FPU_SHIFT;
     __dsb();
     __isb();
 } 
@@ -1669,6 +2999,8 @@ START_TASK_MPU_REGIONS_DEFINITIONS(idle)
 DEFINE_STATIC_STACK_REGION(idle_stack,IDLE_TASK_STACK_SIZE)
 END_TASK_MPU_REGIONS(idle)
 
+// Shared regions are set up once here and never reloaded, context switch only 
+// touches the task regions and skips them when the incoming set is already loaded
 BAD_RTOS_STATIC void __mpu_default_init(){
     BAD_MPU->MAIR[0] = BAD_RTOS_MAIR_SETTINGS;
     
@@ -1697,7 +3029,7 @@ BAD_RTOS_STATIC void __mpu_default_init(){
 #endif
 
 // Memory helpers
-#ifdef BAD_RTOS_USE_KHEAP
+#if defined(BAD_RTOS_USE_KHEAP) && !defined(BAD_RTOS_USE_KHEAP_TLSF)
 
 void  __buddy_init(bad_buddy_t *cb,
                    uint8_t *heap, 
@@ -1721,6 +3053,9 @@ void  __buddy_init(bad_buddy_t *cb,
         cb->free_list[i].prev = &cb->free_list[i];
     }
     cb->heads_bmask = 1;
+#ifdef BAD_RTOS_USE_KHEAP_LAZY_MERGE
+    cb->pending_bmask = 0;
+#endif
 }
 
 static void* __buddy_alloc(bad_buddy_t *cb,uint32_t order){
@@ -1739,7 +3074,7 @@ static void* __buddy_alloc(bad_buddy_t *cb,uint32_t order){
     uint8_t *block_for_split = (uint8_t*)cb->free_list[picked_idx].next;
     cb->free_list[picked_idx].next = cb->free_list[picked_idx].next->next;
     cb->free_list[picked_idx].next->prev = &cb->free_list[picked_idx];
-    cb->heads_bmask ^= (uint32_t)(&cb->free_list[idx] == cb->free_list[idx].next) << picked_idx;
+    cb->heads_bmask ^= (uint32_t)(&cb->free_list[picked_idx] == cb->free_list[picked_idx].next) << picked_idx;
     uint32_t splited_block_size = 1 << (cb->max_order - picked_idx-1);
     bad_link_node_t *unused_block;
     uint32_t bmaskidx, bmask_word, bmask_bit,offset_from_base;
@@ -1773,6 +3108,77 @@ static void* __buddy_alloc(bad_buddy_t *cb,uint32_t order){
     return block_for_split;
 }
 
+#ifdef BAD_RTOS_USE_KHEAP_LAZY_MERGE
+// Pushes a free block without merging, the pair bit still flips so it keeps telling
+// whether exactly one of the buddies is free
+static void __buddy_push_lazy(bad_buddy_t *cb,void *block,uint32_t idx){
+    if(idx){
+        uint32_t offset_from_base = (uint8_t *)block - cb->heap;
+        uint32_t bmaskidx = ((1<<(idx-1))-1) + ((offset_from_base) >> (cb->max_order - idx + 1));
+        uint32_t bmask_word = bmaskidx >> 5;
+        uint32_t bmask_bit = bmaskidx & 31;
+        cb->bmask[bmask_word] ^= 1 << bmask_bit;
+        if(!(cb->bmask[bmask_word] & 1 << bmask_bit)){
+            cb->pending_bmask |= 1 << idx; //the buddy is free as well
+        }
+    }
+    
+    bad_link_node_t *node = (bad_link_node_t *)block;
+    node->next = cb->free_list[idx].next;
+    node->next->prev = node;
+    cb->free_list[idx].next = node;
+    node->prev = &cb->free_list[idx];
+    cb->heads_bmask |= 1 << idx;
+}
+
+static void __buddy_free_lazy(bad_buddy_t *cb,void *block,uint32_t order){
+    if(order > cb->max_order){
+        return;
+    }
+    __buddy_push_lazy(cb, block, cb->max_order - order);
+}
+
+// Merges free pairs smallest order first, merged parents may pair up again one order higher
+// Visits at most budget free blocks, an order leaves pending only once its whole list was walked
+static void __buddy_merge(bad_buddy_t *cb,uint32_t budget){
+    while(cb->pending_bmask && budget){
+        uint32_t idx = 31 - __builtin_clz(cb->pending_bmask);
+        uint32_t order = cb->max_order - idx;
+        bad_link_node_t *head = &cb->free_list[idx];
+        bad_link_node_t *node = head->next;
+        
+        while(node != head && budget){
+            budget--;
+            bad_link_node_t *next = node->next;
+            uint32_t offset_from_base = (uint8_t *)node - cb->heap;
+            uint32_t bmaskidx = ((1<<(idx-1))-1) + ((offset_from_base) >> (order + 1));
+            if(cb->bmask[bmaskidx >> 5] & 1 << (bmaskidx & 31)){
+                node = next; //buddy in use
+                continue;
+            }
+            
+            bad_link_node_t *buddy = (bad_link_node_t *)(cb->heap + (offset_from_base ^ (1U << order)));
+            if(next == buddy){
+                next = buddy->next;
+            }
+            node->prev->next = node->next;
+            node->next->prev = node->prev;
+            buddy->prev->next = buddy->next;
+            buddy->next->prev = buddy->prev;
+            __buddy_push_lazy(cb, cb->heap + (offset_from_base & ~(1U << order)), idx - 1);
+            node = next;
+        }
+        
+        if(head->next == head){
+            cb->heads_bmask &= ~(1U << idx);
+        }
+        if(node != head){
+            return; //out of budget in the middle of the list
+        }
+        cb->pending_bmask &= ~(1U << idx);
+    }
+}
+#else
 static void __buddy_free(bad_buddy_t *cb,void *block,uint32_t order ){
     
     if(order > cb->max_order){
@@ -1822,10 +3228,299 @@ static void __buddy_free(bad_buddy_t *cb,void *block,uint32_t order ){
     final_block->prev = &cb->free_list[idx];
     cb->heads_bmask |= 1 << idx;
 }
+#endif
 
 #endif
 
-#ifdef BAD_RTOS_USE_KHEAP
+#ifdef BAD_RTOS_USE_KHEAP_TLSF
+
+#define BAD_TLSF_BLOCK_FREE     (0x1U)
+#define BAD_TLSF_PREV_FREE      (0x2U)
+#define BAD_TLSF_SIZE_MASK      (~0x3U)
+#define BAD_TLSF_NEXT_PHYS(block) ((bad_tlsf_block_t *)((uint8_t *)(block) + ((block)->size & BAD_TLSF_SIZE_MASK)))
+
+static inline void __tlsf_mapping(uint32_t size, uint32_t *fl, uint32_t *sl){
+    if(size < (1U << KHEAP_TLSF_FL_SHIFT)){
+        *fl = 0;
+        *sl = size >> KHEAP_ALIGN_LOG2;
+        return;
+    }
+    uint32_t msb = 31 - __builtin_clz(size);
+    *fl = msb - KHEAP_TLSF_FL_SHIFT + 1;
+    *sl = (size >> (msb - KHEAP_TLSF_SL_LOG2)) ^ KHEAP_TLSF_SL_COUNT;
+}
+
+static void __tlsf_insert(bad_tlsf_t *cb, bad_tlsf_block_t *block){
+    uint32_t fl, sl;
+    __tlsf_mapping(block->size & BAD_TLSF_SIZE_MASK, &fl, &sl);
+    bad_tlsf_block_t *head = cb->heads[fl][sl];
+    block->next_free = head;
+    block->prev_free = 0;
+    if(head){
+        head->prev_free = block;
+    }
+    cb->heads[fl][sl] = block;
+    cb->fl_bmask |= 1U << fl;
+    cb->sl_bmask[fl] |= 1U << sl;
+}
+
+static void __tlsf_remove(bad_tlsf_t *cb, bad_tlsf_block_t *block){
+    if(block->next_free){
+        block->next_free->prev_free = block->prev_free;
+    }
+    if(block->prev_free){
+        block->prev_free->next_free = block->next_free;
+        return;
+    }
+    
+    uint32_t fl, sl;
+    __tlsf_mapping(block->size & BAD_TLSF_SIZE_MASK, &fl, &sl);
+    cb->heads[fl][sl] = block->next_free;
+    if(!block->next_free){
+        cb->sl_bmask[fl] &= ~(1U << sl);
+        if(!cb->sl_bmask[fl]){
+            cb->fl_bmask &= ~(1U << fl);
+        }
+    }
+}
+
+// Returns the size of the initial free block, 0 if the heap was too small for one
+uint32_t __tlsf_init(bad_tlsf_t *cb, uint8_t *heap, uint32_t size){
+    cb->fl_bmask = 0;
+    for(uint32_t i = 0; i < KHEAP_TLSF_FL_COUNT; i++){
+        cb->sl_bmask[i] = 0;
+        for(uint32_t j = 0; j < KHEAP_TLSF_SL_COUNT; j++){
+            cb->heads[i][j] = 0;
+        }
+    }
+    
+    if(size > (1U << KHEAP_TLSF_MAX_ORDER)){
+        size = 1U << KHEAP_TLSF_MAX_ORDER; //larger blocks have no class
+    }
+    
+    // payloads are aligned, the header sits right below
+    uint8_t *start = (uint8_t *)((((uint32_t)heap + BAD_TLSF_HDR_SIZE + KHEAP_ALIGN - 1) & ~(KHEAP_ALIGN - 1)) - BAD_TLSF_HDR_SIZE);
+    if(start + BAD_TLSF_HDR_SIZE + BAD_TLSF_MIN_BLOCK > heap + size){
+        return 0;
+    }
+    uint32_t block_size = (uint32_t)(heap + size - start - BAD_TLSF_HDR_SIZE) & ~(KHEAP_ALIGN - 1); //room for the end header
+    
+    bad_tlsf_block_t *block = (bad_tlsf_block_t *)start;
+    block->prev_phys = 0;
+    block->size = block_size | BAD_TLSF_BLOCK_FREE;
+    
+    bad_tlsf_block_t *end = BAD_TLSF_NEXT_PHYS(block); //zero sized used block, stops coalescing at the end of the heap
+    end->prev_phys = block;
+    end->size = BAD_TLSF_PREV_FREE;
+    __tlsf_insert(cb, block);
+    return block_size;
+}
+
+static void* __tlsf_alloc(bad_tlsf_t *cb, uint32_t size){
+    if(!size || size > (1U << KHEAP_TLSF_MAX_ORDER)){
+        return 0;
+    }
+    
+    uint32_t need = (size + BAD_TLSF_HDR_SIZE + KHEAP_ALIGN - 1) & ~(KHEAP_ALIGN - 1);
+    if(need < BAD_TLSF_MIN_BLOCK){
+        need = BAD_TLSF_MIN_BLOCK;
+    }
+    
+    // round the search up to the next class, any block found there fits without walking the list
+    uint32_t search = need;
+    if(search >= (1U << KHEAP_TLSF_FL_SHIFT)){
+        search += (1U << (31 - __builtin_clz(search) - KHEAP_TLSF_SL_LOG2)) - 1;
+    }
+    uint32_t fl, sl;
+    __tlsf_mapping(search, &fl, &sl);
+    
+    bad_tlsf_block_t *block = 0;
+    if(fl < KHEAP_TLSF_FL_COUNT){
+        uint32_t sl_map = cb->sl_bmask[fl] & (UINT32_MAX << sl);
+        if(!sl_map){
+            uint32_t fl_map = cb->fl_bmask & (UINT32_MAX << (fl + 1));
+            if(fl_map){
+                fl = __builtin_ctz(fl_map);
+                sl_map = cb->sl_bmask[fl];
+            }
+        }
+        if(sl_map){
+            block = cb->heads[fl][__builtin_ctz(sl_map)];
+        }
+    }
+    
+    if(!block){ //nothing in the rounded classes, the head of the exact class may still fit
+        __tlsf_mapping(need, &fl, &sl);
+        block = cb->heads[fl][sl];
+        if(!block || (block->size & BAD_TLSF_SIZE_MASK) < need){
+            return 0;
+        }
+    }
+    __tlsf_remove(cb, block);
+    
+    uint32_t block_size = block->size & BAD_TLSF_SIZE_MASK;
+    if(block_size - need >= BAD_TLSF_MIN_BLOCK){
+        bad_tlsf_block_t *rest = (bad_tlsf_block_t *)((uint8_t *)block + need);
+        rest->prev_phys = block;
+        rest->size = (block_size - need) | BAD_TLSF_BLOCK_FREE;
+        BAD_TLSF_NEXT_PHYS(rest)->prev_phys = rest; //keeps its prev free flag
+        __tlsf_insert(cb, rest);
+        block_size = need;
+    }else{
+        BAD_TLSF_NEXT_PHYS(block)->size &= ~BAD_TLSF_PREV_FREE;
+    }
+    block->size = block_size; //free blocks never border each other, so the previous one is used
+    
+    return (uint8_t *)block + BAD_TLSF_HDR_SIZE;
+}
+
+static void __tlsf_free(bad_tlsf_t *cb, void *ptr){
+    if(!ptr){
+        return;
+    }
+    
+    bad_tlsf_block_t *block = (bad_tlsf_block_t *)((uint8_t *)ptr - BAD_TLSF_HDR_SIZE);
+    if(block->size & BAD_TLSF_BLOCK_FREE){
+        return;
+    }
+    
+    if(block->size & BAD_TLSF_PREV_FREE){
+        bad_tlsf_block_t *prev = block->prev_phys;
+        __tlsf_remove(cb, prev);
+        prev->size += block->size & BAD_TLSF_SIZE_MASK;
+        block = prev;
+    }else{
+        block->size |= BAD_TLSF_BLOCK_FREE;
+    }
+    
+    bad_tlsf_block_t *next = BAD_TLSF_NEXT_PHYS(block);
+    if(next->size & BAD_TLSF_BLOCK_FREE){
+        __tlsf_remove(cb, next);
+        block->size += next->size & BAD_TLSF_SIZE_MASK;
+        next = BAD_TLSF_NEXT_PHYS(block);
+    }
+    next->prev_phys = block;
+    next->size |= BAD_TLSF_PREV_FREE;
+    __tlsf_insert(cb, block);
+}
+
+#ifdef BAD_RTOS_USE_HEAP_STATS
+// Largest payload an allocation is sure to get, the head of the highest class. Blocks behind it
+// in the same list may be bigger but the allocation only looks at the head
+static uint32_t __tlsf_largest(bad_tlsf_t *cb){
+    if(!cb->fl_bmask){
+        return 0;
+    }
+    uint32_t fl = 31 - __builtin_clz(cb->fl_bmask);
+    uint32_t sl = 31 - __builtin_clz(cb->sl_bmask[fl]);
+    return (cb->heads[fl][sl]->size & BAD_TLSF_SIZE_MASK) - BAD_TLSF_HDR_SIZE;
+}
+
+// Counted by the whole block the allocation got, the free lists lose exactly that much
+BAD_RTOS_STATIC void __tlsf_count_alloc(void *ptr){
+    if(!ptr){
+        kmem_counters.kheap_fails++;
+        return;
+    }
+    kmem_counters.kheap_allocs++;
+    kmem_counters.kheap_free -= ((bad_tlsf_block_t *)((uint8_t *)ptr - BAD_TLSF_HDR_SIZE))->size & BAD_TLSF_SIZE_MASK;
+    if(kmem_counters.kheap_free < kmem_counters.kheap_min_free){
+        kmem_counters.kheap_min_free = kmem_counters.kheap_free;
+    }
+}
+
+// Called before the free, a block that is already free is rejected by it and not counted
+BAD_RTOS_STATIC void __tlsf_count_free(void *ptr){
+    if(!ptr){
+        return;
+    }
+    bad_tlsf_block_t *block = (bad_tlsf_block_t *)((uint8_t *)ptr - BAD_TLSF_HDR_SIZE);
+    if(!(block->size & BAD_TLSF_BLOCK_FREE)){
+        kmem_counters.kheap_free += block->size & BAD_TLSF_SIZE_MASK;
+    }
+}
+#endif
+
+#ifdef BAD_RTOS_USE_KHEAP_ARENAS
+BAD_RTOS_STATIC void* __arenas_alloc(uint32_t size, bad_kheap_policy_t policy){
+    if(policy == BAD_KHEAP_FASTEST_FIRST){
+        for(uint32_t i = 0; i < BAD_RTOS_KHEAP_ARENA_COUNT; i++){
+            void *block = __tlsf_alloc(&kernel_arenas[i], size);
+            if(block){
+                return block;
+            }
+        }
+        return 0;
+    }
+    
+    // arena indices are packed into nibbles, first to try in the lowest one, 0xF ends the chain
+    for(uint32_t i = 0; i < 8 && (policy & 0xF) != 0xF; i++, policy >>= 4){
+        uint32_t arena = policy & 0xF;
+        if(arena >= BAD_RTOS_KHEAP_ARENA_COUNT){
+            continue;
+        }
+        void *block = __tlsf_alloc(&kernel_arenas[arena], size);
+        if(block){
+            return block;
+        }
+    }
+    return 0;
+}
+
+BAD_RTOS_STATIC void* __kernel_alloc_from(uint32_t size, bad_kheap_policy_t policy){
+    void *block = __arenas_alloc(size, policy);
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    __tlsf_count_alloc(block);
+#endif
+    return block;
+}
+
+BAD_RTOS_STATIC void* __kernel_alloc(uint32_t size){
+    return __kernel_alloc_from(size, BAD_KHEAP_FASTEST_FIRST);
+}
+
+BAD_RTOS_STATIC void __kernel_free(void *block,uint32_t size){
+    (void)size; //blocks carry their own size
+    for(uint32_t i = 0; i < BAD_RTOS_KHEAP_ARENA_COUNT; i++){
+        if((uint8_t *)block >= kheap_banks[i].start && (uint8_t *)block < kheap_banks[i].end){
+#ifdef BAD_RTOS_USE_HEAP_STATS
+            __tlsf_count_free(block);
+#endif
+            __tlsf_free(&kernel_arenas[i], block);
+            return;
+        }
+    }
+}
+
+BAD_RTOS_STATIC void __kheap_arenas_init(){
+    for(uint32_t i = 0; i < BAD_RTOS_KHEAP_ARENA_COUNT; i++){
+        uint32_t free = __tlsf_init(&kernel_arenas[i], kheap_banks[i].start, kheap_banks[i].end - kheap_banks[i].start);
+#ifdef BAD_RTOS_USE_HEAP_STATS
+        kmem_counters.kheap_size += free;
+#else
+        (void)free;
+#endif
+    }
+}
+#else
+BAD_RTOS_STATIC void* __kernel_alloc(uint32_t size){
+    void *block = __tlsf_alloc(&kernel_tlsf, size);
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    __tlsf_count_alloc(block);
+#endif
+    return block;
+}
+
+BAD_RTOS_STATIC void __kernel_free(void *block,uint32_t size){
+    (void)size; //blocks carry their own size
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    __tlsf_count_free(block);
+#endif
+    __tlsf_free(&kernel_tlsf, block);
+}
+#endif
+
+#elif defined(BAD_RTOS_USE_KHEAP)
 
 BAD_RTOS_STATIC void* __kernel_alloc(uint32_t size){
     uint32_t closest_order;
@@ -1833,7 +3528,25 @@ BAD_RTOS_STATIC void* __kernel_alloc(uint32_t size){
     if(closest_order < kernel_buddy.min_order){
         closest_order = kernel_buddy.min_order;
     }
-    return __buddy_alloc(&kernel_buddy,closest_order );
+    void *block = __buddy_alloc(&kernel_buddy,closest_order );
+#ifdef BAD_RTOS_USE_KHEAP_LAZY_MERGE
+    if(!block && kernel_buddy.pending_bmask){ //the block may be sitting in unmerged pairs
+        __buddy_merge(&kernel_buddy, UINT32_MAX);
+        block = __buddy_alloc(&kernel_buddy,closest_order );
+    }
+#endif
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    if(!block){
+        kmem_counters.kheap_fails++;
+        return 0;
+    }
+    kmem_counters.kheap_allocs++;
+    kmem_counters.kheap_free -= 1U << closest_order;
+    if(kmem_counters.kheap_free < kmem_counters.kheap_min_free){
+        kmem_counters.kheap_min_free = kmem_counters.kheap_free;
+    }
+#endif
+    return block;
 }
 
 BAD_RTOS_STATIC void __kernel_free(void *block,uint32_t size){
@@ -1842,11 +3555,50 @@ BAD_RTOS_STATIC void __kernel_free(void *block,uint32_t size){
     if(closest_order < kernel_buddy.min_order){
         closest_order = kernel_buddy.min_order;
     }
+    if(closest_order > kernel_buddy.max_order){ //the buddy rejects it, nothing goes back to the heap
+        return;
+    }
+#ifdef BAD_RTOS_USE_KHEAP_LAZY_MERGE
+    __buddy_free_lazy(&kernel_buddy,block,closest_order );
+#else
     __buddy_free(&kernel_buddy,block,closest_order );
+#endif
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    kmem_counters.kheap_free += 1U << closest_order;
+#endif
     
 }
 #endif
 
+#if BAD_RTOS_MAX_TASKS > 32
+BAD_RTOS_STATIC void __tcb_queue_slab_init(){
+    for (uint32_t i = 0; i < BAD_RTOS_MAX_TASKS / 32; i++){
+        tcbslab.free_bitmask[i] = UINT32_MAX;
+    }
+#if BAD_RTOS_MAX_TASKS % 32
+    tcbslab.free_bitmask[BAD_RTOS_TASK_WORDS - 1] = (1UL<<(BAD_RTOS_MAX_TASKS % 32))-1;
+#endif
+    tcbslab.free_summary = (BAD_RTOS_TASK_WORDS == 32) ? UINT32_MAX : (1UL<<BAD_RTOS_TASK_WORDS)-1;
+}
+
+BAD_RTOS_STATIC bad_tcb_t *__tcb_slab_alloc(){
+    if(tcbslab.free_summary == 0){
+        return 0; 
+    }
+    uint32_t word = __builtin_ctz(tcbslab.free_summary);
+    uint32_t block_idx = __builtin_ctz(tcbslab.free_bitmask[word]);
+    tcbslab.free_bitmask[word] &= ~(1UL<<block_idx);
+    if(!tcbslab.free_bitmask[word]){
+        tcbslab.free_summary &= ~(1UL<<word);
+    }
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    if(++kmem_counters.tasks > kmem_counters.max_tasks){
+        kmem_counters.max_tasks = kmem_counters.tasks;
+    }
+#endif
+    return tcbslab.node_arr + (word << 5) + block_idx;
+}
+#else
 BAD_RTOS_STATIC void __tcb_queue_slab_init(){
 #if BAD_RTOS_MAX_TASKS < 32
     tcbslab.free_bitmask = (1UL<<(BAD_RTOS_MAX_TASKS))-1;
@@ -1861,17 +3613,23 @@ BAD_RTOS_STATIC bad_tcb_t *__tcb_slab_alloc(){
     }
     uint8_t block_idx = __builtin_ctz(tcbslab.free_bitmask);
     tcbslab.free_bitmask &= ~(1UL<<block_idx);
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    if(++kmem_counters.tasks > kmem_counters.max_tasks){
+        kmem_counters.max_tasks = kmem_counters.tasks;
+    }
+#endif
     return tcbslab.node_arr + block_idx;
 }
+#endif
 
-BAD_RTOS_STATIC uint8_t __tcb_slab_get_idx_from_ptr(bad_tcb_t *block){
-    if(tcbslab.node_arr > block || tcbslab.node_arr + BAD_RTOS_MAX_TASKS < block){
-        return 0xFF;
+BAD_RTOS_STATIC uint32_t __tcb_slab_get_idx_from_ptr(bad_tcb_t *block){
+    if(tcbslab.node_arr > block || tcbslab.node_arr + BAD_RTOS_MAX_TASKS <= block){
+        return 0xFFFF;
     }
     return block - tcbslab.node_arr;
 }
 
-BAD_RTOS_STATIC bad_tcb_t *__tcb_slab_get_ptr_from_idx(uint8_t idx){
+BAD_RTOS_STATIC bad_tcb_t *__tcb_slab_get_ptr_from_idx(uint32_t idx){
     if(idx >= BAD_RTOS_MAX_TASKS){
         return 0;
     }
@@ -1879,11 +3637,19 @@ BAD_RTOS_STATIC bad_tcb_t *__tcb_slab_get_ptr_from_idx(uint8_t idx){
 }
 
 BAD_RTOS_STATIC void __tcb_slab_free(bad_tcb_t *tcb){
-    uint8_t block_idx = __tcb_slab_get_idx_from_ptr(tcb); 
+    uint32_t block_idx = __tcb_slab_get_idx_from_ptr(tcb); 
     if(block_idx >= BAD_RTOS_MAX_TASKS){
         return;
     }
+#if BAD_RTOS_MAX_TASKS > 32
+    tcbslab.free_bitmask[block_idx >> 5] |= (1UL<<(block_idx & 31));
+    tcbslab.free_summary |= (1UL<<(block_idx >> 5));
+#else
     tcbslab.free_bitmask |= (1ULL<<block_idx); 
+#endif
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    kmem_counters.tasks--;
+#endif
 }
 
 BAD_RTOS_STATIC void *__obj_list_pull_atomic(volatile void* list){
@@ -1906,20 +3672,61 @@ BAD_RTOS_STATIC void __obj_list_push_atomic(volatile void *list,void *obj){
     }while(__strex((uint32_t)new_head, (volatile uint32_t *)list));
 }
 
+#ifdef BAD_RTOS_USE_HEAP_STATS
+BAD_RTOS_STATIC void __pool_count(volatile uint32_t *counter, uint32_t delta){
+    uint32_t value;
+    do{
+        value = __ldrex(counter) + delta;
+    }while(__strex(value, counter));
+}
+
+// Counts a block going out and raises the high water mark, counted after the pull so
+// in_use can lag behind but never runs ahead of the blocks really handed out
+BAD_RTOS_STATIC void __pool_count_alloc(bad_pool_t *pool){
+    uint32_t in_use;
+    do{
+        in_use = __ldrex(&pool->in_use) + 1;
+    }while(__strex(in_use, &pool->in_use));
+    uint32_t max_in_use;
+    do{
+        max_in_use = __ldrex(&pool->max_in_use);
+        if(max_in_use >= in_use){
+            __clrex();
+            return;
+        }
+    }while(__strex(in_use, &pool->max_in_use));
+}
+#endif
+
 bad_rtos_status_t pool_init(bad_pool_t *pool,void *mem,uint32_t block_size,uint32_t size_in_bytes){
     if(!pool || !mem || !block_size ||!size_in_bytes || size_in_bytes % block_size){
         return BAD_RTOS_STATUS_BAD_PARAMETERS;
     }
     pool->mem = mem;
     pool->block_size = block_size;
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    pool->in_use = 0;
+    pool->max_in_use = 0;
+    pool->fails = 0;
+#endif
+#ifdef BAD_RTOS_USE_POOL_WAIT
+    pool->blockedq = (bad_link_node_t){0};
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    pool->waitq_index.bmask = 0;
+#endif
+#endif
     BAD_OPT_BARRIER;
     pool->size_in_bytes = size_in_bytes;
     return BAD_RTOS_STATUS_OK;
 }
 
-void* pool_alloc(bad_pool_t *pool){
+// Lock free part of the allocation, the free list first, then the untouched memory
+BAD_RTOS_STATIC void* __pool_take(bad_pool_t *pool){
     void *res =__obj_list_pull_atomic(&pool->next);
     if(res){
+#ifdef BAD_RTOS_USE_HEAP_STATS
+        __pool_count_alloc(pool);
+#endif
         return res;
     }
     uint32_t curr;
@@ -1930,16 +3737,68 @@ void* pool_alloc(bad_pool_t *pool){
         }
         
     }while(__strex(curr+pool->block_size,&pool->curr));
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    __pool_count_alloc(pool);
+#endif
     return pool->mem + curr;
 }
 
+void* pool_alloc(bad_pool_t *pool){
+    void *res = __pool_take(pool);
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    if(!res){
+        __pool_count(&pool->fails, 1);
+    }
+#endif
+    return res;
+}
+
 void pool_free(bad_pool_t *pool,void *obj){
     uint8_t *cmp_ptr = obj;
     if(pool->mem > cmp_ptr || pool->mem + pool->size_in_bytes <= cmp_ptr){  
         __builtin_trap();
     }
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    __pool_count(&pool->in_use, UINT32_MAX); //before the push, a racing alloc must not see the block counted twice
+#endif
+#ifdef BAD_RTOS_USE_POOL_WAIT
+    // same push as __obj_list_push_atomic, the waiters check sits inside the exclusive window 
+    // so a task blocking in between makes the strex fail and the loop see it
+    uint32_t *new_head = obj;
+    uint32_t head;
+    uint32_t in_isr = __get_ipsr();
+    do{
+        head = __ldrex((volatile uint32_t *)&pool->next);
+        if(!in_isr && ((volatile bad_link_node_t *)&pool->blockedq)->next){
+            __clrex();
+            __svc_pool_free(pool,obj);
+            return;
+        }
+        *new_head = head;
+    }while(__strex((uint32_t)new_head, (volatile uint32_t *)&pool->next));
+    // tasks only wait on an empty free list, pendsv hands the blocks to them
+    // so a burst of frees is already on the list when it runs
+    if(in_isr && !head){
+        __kernel_notify(&pool->isr_node,BAD_ISR_OP_POOL_WAKE,pool,1);
+    }
+#else
     __obj_list_push_atomic(pool,obj);
+#endif
+}
+
+#ifdef BAD_RTOS_USE_POOL_WAIT
+void* pool_alloc_wait(bad_pool_t *pool,uint32_t delay){
+    void *res = __pool_take(pool);
+    if(res){
+        return res;
+    }
+    res = __svc_pool_alloc_wait(pool,delay);
+    if((uint32_t)res == BAD_RTOS_STATUS_SCHED_LOCKED){
+        return 0; //no blocking with the scheduler locked
+    }
+    return res;
 }
+#endif
 
 void* gpool_alloc(){
     return pool_alloc(&gpool);
@@ -1949,42 +3808,311 @@ void gpool_free(void *obj){
     pool_free(&gpool,obj);
 }
 
-//Scheduling helpers
+#ifdef BAD_RTOS_USE_HEAP_STATS
+bad_rtos_status_t pool_stats(bad_pool_t *pool,bad_pool_stats_t *stats){
+    if(!pool || !stats || !pool->size_in_bytes){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    uint32_t blocks = pool->size_in_bytes / pool->block_size;
+    uint32_t in_use, max_in_use, fails;
+    do{
+        in_use = pool->in_use;
+        max_in_use = pool->max_in_use;
+        fails = pool->fails;
+    }while(in_use != pool->in_use); //an alloc or free got in between
+    if(max_in_use < in_use){
+        max_in_use = in_use; //alloc caught between its two counters
+    }
+    stats->blocks = blocks;
+    stats->free = blocks - in_use;
+    stats->min_free = blocks - max_in_use;
+    stats->fails = fails;
+    return BAD_RTOS_STATUS_OK;
+}
 
-BAD_RTOS_STATIC void __prio_list_enqueue(bad_link_node_t *q,bad_tcb_t *tcb, bad_rtos_misc_t target){
-    
-    bad_link_node_t *traverse = q->next;
-    bad_link_node_t *prev = q;
-    bad_tcb_t *tcb_to_compare = BAD_CONTAINER_OF(traverse,bad_tcb_t,qnode);
-    while (traverse && tcb_to_compare->raised_priority <= tcb->raised_priority) {
-        prev = traverse;
-        traverse = traverse->next;
-        tcb_to_compare = BAD_CONTAINER_OF(traverse,bad_tcb_t,qnode);
+BAD_RTOS_STATIC bad_rtos_status_t __kernel_mem_stats(bad_mem_stats_t *stats){
+    if(!stats){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
     }
-    bad_link_node_t *tcb_qnode_ptr = &tcb->qnode; 
-    tcb_qnode_ptr->next = traverse;
-    tcb_qnode_ptr->prev = prev;
-    tcb->misc = target;
-    if(traverse){
-        traverse->prev = tcb_qnode_ptr;
+#ifdef BAD_RTOS_USE_KHEAP
+    stats->kheap_size = kmem_counters.kheap_size;
+    stats->kheap_free = kmem_counters.kheap_free;
+    stats->kheap_min_free = kmem_counters.kheap_min_free;
+    stats->kheap_allocs = kmem_counters.kheap_allocs;
+    stats->kheap_fails = kmem_counters.kheap_fails;
+#endif
+#ifdef BAD_RTOS_USE_KHEAP_ARENAS
+    stats->kheap_largest_free = 0;
+    for(uint32_t i = 0; i < BAD_RTOS_KHEAP_ARENA_COUNT; i++){
+        uint32_t largest = __tlsf_largest(&kernel_arenas[i]);
+        if(largest > stats->kheap_largest_free){
+            stats->kheap_largest_free = largest;
+        }
     }
-    tcb_qnode_ptr->prev->next = tcb_qnode_ptr;
+#elif defined(BAD_RTOS_USE_KHEAP_TLSF)
+    stats->kheap_largest_free = __tlsf_largest(&kernel_tlsf);
+#elif defined(BAD_RTOS_USE_KHEAP)
+#ifdef BAD_RTOS_USE_KHEAP_LAZY_MERGE
+    __buddy_merge(&kernel_buddy, UINT32_MAX); //unmerged pairs would hide the blocks an allocation can still get
+#endif
+    stats->kheap_largest_free = kernel_buddy.heads_bmask ? 1U << (KMAX_ORDER - __builtin_ctz(kernel_buddy.heads_bmask)) : 0;
+    for(uint32_t i = 0; i < 32; i++){
+        stats->kheap_free_blocks[i] = 0;
+    }
+    for(uint32_t idx = 0; idx < KFREE_LIST_SIZE; idx++){
+        uint32_t count = 0;
+        for(bad_link_node_t *node = kfreelist[idx].next; node != &kfreelist[idx]; node = node->next){
+            count++;
+        }
+        stats->kheap_free_blocks[KMAX_ORDER - idx] = count;
+    }
+#endif
+    stats->tasks = kmem_counters.tasks;
+    stats->max_tasks = kmem_counters.max_tasks;
+    return pool_stats(&gpool, &stats->gpool);
 }
+#endif
 
-BAD_RTOS_STATIC void __readyq_enqueue(bad_tcb_t *tcb){
-    bad_link_node_t *head =  &kernel_cb.readyq[tcb->raised_priority];
+#ifdef BAD_RTOS_USE_SLAB
+BAD_RTOS_STATIC uint32_t __slab_class(uint32_t size){
+    if(size <= (1U << BAD_SLAB_MIN_ORDER)){
+        return 0;
+    }
+    return 32 - __builtin_clz(size - 1) - BAD_SLAB_MIN_ORDER;
+}
+
+// Svc side, carves a fresh page, the first object goes to the caller
+BAD_RTOS_STATIC void* __slab_refill(uint32_t size_class){
+    if(size_class >= BAD_SLAB_CLASS_COUNT){
+        return 0;
+    }
+    
+    uint8_t *page = __kernel_alloc(BAD_RTOS_SLAB_PAGE_SIZE);
+    if(!page){
+        return 0;
+    }
+    
+    uint32_t obj_size = 1U << (size_class + BAD_SLAB_MIN_ORDER);
+    uint8_t *first = page + obj_size;
+    uint8_t *last = page + (BAD_RTOS_SLAB_PAGE_SIZE / obj_size - 1) * obj_size;
+    if(first > last){
+        return page;
+    }
+    for(uint8_t *obj = first; obj < last; obj += obj_size){
+        *(uint8_t **)obj = obj + obj_size;
+    }
+    // isrs may push and pull while the chain is built, it is spliced in with a single exchange
+    uint8_t *head;
+    do{
+        head = (uint8_t *)__ldrex((volatile uint32_t *)&slab_heads[size_class]);
+        *(uint8_t **)last = head;
+    }while(__strex((uint32_t)first, (volatile uint32_t *)&slab_heads[size_class]));
+    return page;
+}
+
+void* slab_alloc(uint32_t size){
+    if(!size){
+        return 0;
+    }
+    
+    if(size > (1U << BAD_SLAB_MAX_ORDER)){
+        return __get_ipsr() ? 0 : kernel_alloc(size);
+    }
+    
+    uint32_t size_class = __slab_class(size);
+    void *obj = __obj_list_pull_atomic(&slab_heads[size_class]);
+    if(obj || __get_ipsr()){
+        return obj;
+    }
+    return __svc_slab_refill(size_class);
+}
+
+void slab_free(void *obj, uint32_t size){
+    if(!obj || !size){
+        return;
+    }
+    
+    if(size > (1U << BAD_SLAB_MAX_ORDER)){
+        if(__get_ipsr()){
+            __builtin_trap();
+        }
+        kernel_free(obj, size);
+        return;
+    }
+    __obj_list_push_atomic(&slab_heads[__slab_class(size)], obj);
+}
+#endif
+
+#ifdef BAD_RTOS_USE_KHEAP_MAGAZINES
+BAD_RTOS_STATIC uint32_t __kheap_order(uint32_t size){
+    uint32_t order = 32 - __builtin_clz(size) - !(size & (size - 1));
+    return order < KMIN_ORDER ? KMIN_ORDER : order;
+}
+
+// Svc side of a refill, stops at the first failed allocation
+BAD_RTOS_STATIC uint32_t __kernel_alloc_batch(uint32_t order, void **rounds, uint32_t count){
+    uint32_t filled = 0;
+    for(; filled < count; filled++){
+        rounds[filled] = __kernel_alloc(1U << order);
+        if(!rounds[filled]){
+            break;
+        }
+    }
+    return filled;
+}
+
+BAD_RTOS_STATIC void __kernel_free_batch(uint32_t order, void **rounds, uint32_t count){
+    for(uint32_t i = 0; i < count; i++){
+        __kernel_free(rounds[i], 1U << order);
+    }
+}
+
+BAD_RTOS_STATIC bad_magazine_t *__magazine_self(){
+    bad_tcb_t *self = shared_curr;
+    if(!self || __get_ipsr()){ //not started yet or called from the kernel
+        return 0;
+    }
+    return &task_magazines[self - tcbslab.node_arr];
+}
+
+void* kernel_alloc(uint32_t size){
+    if(!size){
+        return 0;
+    }
+    
+    uint32_t order = __kheap_order(size);
+    uint32_t idx = order - KMIN_ORDER;
+    if(idx >= BAD_RTOS_MAGAZINE_ORDERS){
+        return __svc_kernel_alloc(size);
+    }
+    
+    bad_magazine_t *mag = __magazine_self();
+    if(!mag){
+        return __svc_kernel_alloc(1U << order); //whole order, the block may end up in a magazine later
+    }
+    
+    if(!mag->count[idx]){
+        mag->count[idx] = __svc_kernel_alloc_batch(order, mag->rounds[idx], BAD_RTOS_MAGAZINE_SIZE / 2 + 1);
+        if(!mag->count[idx]){
+            return 0;
+        }
+    }
+    return mag->rounds[idx][--mag->count[idx]];
+}
+
+void kernel_free(void *block, uint32_t size){
+    if(!block || !size){
+        return;
+    }
+    
+    uint32_t order = __kheap_order(size);
+    uint32_t idx = order - KMIN_ORDER;
+    bad_magazine_t *mag = __magazine_self();
+    if(idx >= BAD_RTOS_MAGAZINE_ORDERS || !mag){
+        __svc_kernel_free(block, idx < BAD_RTOS_MAGAZINE_ORDERS ? 1U << order : size);
+        return;
+    }
+    
+    if(mag->count[idx] == BAD_RTOS_MAGAZINE_SIZE){ //flush the upper half, the lower one keeps serving
+        __svc_kernel_free_batch(order, &mag->rounds[idx][BAD_RTOS_MAGAZINE_SIZE / 2], BAD_RTOS_MAGAZINE_SIZE - BAD_RTOS_MAGAZINE_SIZE / 2);
+        mag->count[idx] = BAD_RTOS_MAGAZINE_SIZE / 2;
+    }
+    mag->rounds[idx][mag->count[idx]++] = block;
+}
+
+BAD_RTOS_STATIC void __magazine_flush(bad_tcb_t *tcb){
+    bad_magazine_t *mag = &task_magazines[tcb - tcbslab.node_arr];
+    for(uint32_t i = 0; i < BAD_RTOS_MAGAZINE_ORDERS; i++){
+        __kernel_free_batch(KMIN_ORDER + i, mag->rounds[i], mag->count[i]);
+        mag->count[i] = 0;
+    }
+}
+#endif
+
+//Scheduling helpers
+
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+BAD_RTOS_STATIC void __prio_list_enqueue(bad_link_node_t *q,bad_tcb_t *tcb, bad_rtos_misc_t target){
+    bad_waitq_index_t *index = BAD_WAITQ_INDEX(q);
+    uint32_t prio = tcb->raised_priority;
+    uint32_t level = BAD_WAITQ_LEVEL(prio);
+    uint32_t same_or_higher = index->bmask & (UINT32_MAX >> (31 - level));
+    bad_link_node_t *prev = q;
+    if(same_or_higher){
+        uint32_t top = 31 - __builtin_clz(same_or_higher);
+        prev = &tcbslab.node_arr[index->tails[top]].qnode;
+        // a shared level is walked back over its lower priority waiters, it ends at the higher levels
+        while(top == level && prev != q && BAD_CONTAINER_OF(prev,bad_tcb_t,qnode)->wait_priority > prio){
+            prev = prev->prev;
+        }
+    }
+    bad_link_node_t *tcb_qnode_ptr = &tcb->qnode;
+    tcb_qnode_ptr->next = prev->next;
+    tcb_qnode_ptr->prev = prev;
+    tcb->misc = target;
+    tcb->wait_priority = prio;
+    if(prev->next){
+        prev->next->prev = tcb_qnode_ptr;
+    }
+    prev->next = tcb_qnode_ptr;
+    if(!tcb_qnode_ptr->next){
+        index->tails[level] = __tcb_slab_get_idx_from_ptr(tcb);
+    }else if(BAD_WAITQ_LEVEL(BAD_CONTAINER_OF(tcb_qnode_ptr->next,bad_tcb_t,qnode)->wait_priority) != level){
+        index->tails[level] = __tcb_slab_get_idx_from_ptr(tcb);
+    }
+    index->bmask |= 1UL << level;
+}
+#else
+BAD_RTOS_STATIC void __prio_list_enqueue(bad_link_node_t *q,bad_tcb_t *tcb, bad_rtos_misc_t target){
+    
+    bad_link_node_t *traverse = q->next;
+    bad_link_node_t *prev = q;
+    bad_tcb_t *tcb_to_compare = BAD_CONTAINER_OF(traverse,bad_tcb_t,qnode);
+    while (traverse && tcb_to_compare->raised_priority <= tcb->raised_priority) {
+        prev = traverse;
+        traverse = traverse->next;
+        tcb_to_compare = BAD_CONTAINER_OF(traverse,bad_tcb_t,qnode);
+    }
+    bad_link_node_t *tcb_qnode_ptr = &tcb->qnode; 
+    tcb_qnode_ptr->next = traverse;
+    tcb_qnode_ptr->prev = prev;
+    tcb->misc = target;
+    if(traverse){
+        traverse->prev = tcb_qnode_ptr;
+    }
+    tcb_qnode_ptr->prev->next = tcb_qnode_ptr;
+}
+#endif
+
+BAD_RTOS_STATIC void __readyq_enqueue(bad_tcb_t *tcb){
+    bad_link_node_t *head =  &kernel_cb.readyq[tcb->raised_priority];
     bad_link_node_t *tcb_qnode_ptr = &tcb->qnode;
     tcb_qnode_ptr->prev = head->prev;
     tcb_qnode_ptr->next = head;
     tcb_qnode_ptr->prev->next = tcb_qnode_ptr;
     head->prev = tcb_qnode_ptr;
+#if BAD_RTOS_PRIO_COUNT > 32
+    kernel_cb.ready_leaf[tcb->raised_priority >> 5] |= 1UL << (tcb->raised_priority & 31);
+    kernel_cb.ready_bmask |= 1UL << (tcb->raised_priority >> 5);
+#else
     kernel_cb.ready_bmask |= 1 << tcb->raised_priority;
+#endif
     tcb->misc = BAD_RTOS_MISC_READYQ_MEMBER;
 }
 
+#if BAD_RTOS_PRIO_COUNT > 32
+BAD_RTOS_STATIC uint32_t __get_top_ready_prio(){
+    if(!kernel_cb.ready_bmask){
+        return BAD_RTOS_PRIO_COUNT;
+    }
+    uint32_t word = __builtin_ctz(kernel_cb.ready_bmask);
+    return (word << 5) + __builtin_ctz(kernel_cb.ready_leaf[word]);
+}
+#else
 BAD_RTOS_STATIC uint32_t __get_top_ready_prio(){
     return __builtin_ctz(kernel_cb.ready_bmask);
 }
+#endif
 
 BAD_RTOS_STATIC bad_tcb_t *__readyq_dequeue_head(){
     uint32_t top = __get_top_ready_prio();
@@ -1994,10 +4122,47 @@ BAD_RTOS_STATIC bad_tcb_t *__readyq_dequeue_head(){
     tcb_qnode_ptr->prev->next = tcb_qnode_ptr->next;
     tcb_qnode_ptr->next = 0;
     tcb_qnode_ptr->prev = 0;
+#if BAD_RTOS_PRIO_COUNT > 32
+    if(kernel_cb.readyq[top].next == &kernel_cb.readyq[top]){
+        kernel_cb.ready_leaf[top >> 5] &= ~(1UL << (top & 31));
+        kernel_cb.ready_bmask &= ~((uint32_t)!kernel_cb.ready_leaf[top >> 5] << (top >> 5));
+    }
+#else
     kernel_cb.ready_bmask ^= (kernel_cb.readyq[top].next ==  &kernel_cb.readyq[top]) << top;
+#endif
     return tcb;
 }
 
+// Unlinks a ready task from the list of its current priority, the bitmask bit goes when the list empties
+BAD_RTOS_STATIC void __readyq_remove(bad_tcb_t *tcb){
+    uint32_t prio = tcb->raised_priority;
+    bad_link_node_t *tcb_qnode_ptr = &tcb->qnode;
+    tcb_qnode_ptr->next->prev = tcb_qnode_ptr->prev;
+    tcb_qnode_ptr->prev->next = tcb_qnode_ptr->next;
+    tcb_qnode_ptr->next = 0;
+    tcb_qnode_ptr->prev = 0;
+    if(kernel_cb.readyq[prio].next == &kernel_cb.readyq[prio]){
+#if BAD_RTOS_PRIO_COUNT > 32
+        kernel_cb.ready_leaf[prio >> 5] &= ~(1UL << (prio & 31));
+        kernel_cb.ready_bmask &= ~((uint32_t)!kernel_cb.ready_leaf[prio >> 5] << (prio >> 5));
+#else
+        kernel_cb.ready_bmask &= ~(1UL << prio);
+#endif
+    }
+}
+
+// Changes the running priority of a task, a ready task moves to the list of the new priority
+BAD_RTOS_STATIC void __task_set_raised_priority(bad_tcb_t *tcb, uint32_t prio){
+    if(tcb->misc != BAD_RTOS_MISC_READYQ_MEMBER){
+        tcb->raised_priority = prio;
+        return;
+    }
+    __readyq_remove(tcb);
+    tcb->raised_priority = prio;
+    __readyq_enqueue(tcb);
+}
+
+#ifndef BAD_RTOS_USE_TIMING_WHEEL
 BAD_RTOS_STATIC void __delayq_enqueue(bad_tcb_t *tcb, uint32_t absolute){
     
     bad_link_node_t *traverse = kernel_cb.delayq.next;
@@ -2045,31 +4210,165 @@ BAD_RTOS_STATIC bad_rtos_status_t __delayq_dequeue(bad_tcb_t *tcb){
     return BAD_RTOS_STATUS_OK;
 }
 
-BAD_RTOS_STATIC bad_tcb_t* __prio_list_dequeue_head(bad_link_node_t *q){
-    bad_link_node_t *head = q->next;
-    if(!head){
+BAD_RTOS_STATIC bad_tcb_t* __delayq_dequeue_expired(){
+    bad_link_node_t *head = kernel_cb.delayq.next;
+    if(!head || BAD_CONTAINER_OF(head,bad_tcb_t,delaynode)->counter){
         return 0;
     }
     bad_link_node_t *new_head = head->next; 
-    q->next = new_head;
+    kernel_cb.delayq.next = new_head;
     if(new_head){
-        new_head->prev = q;
+        new_head->prev = &kernel_cb.delayq;
+    }
+    bad_tcb_t *head_tcb = BAD_CONTAINER_OF(head,bad_tcb_t,delaynode);
+    head_tcb->delayq_misc = BAD_RTOS_MISC_NOT_DELAYED; 
+    return head_tcb;
+}
+
+#ifdef BAD_RTOS_USE_TICKLESS_IDLE
+BAD_RTOS_STATIC uint32_t __delayq_next_expiry(){
+    if(!kernel_cb.delayq.next){
+        return UINT32_MAX;
     }
-    return BAD_CONTAINER_OF(head,bad_tcb_t,qnode);
+    return BAD_CONTAINER_OF(kernel_cb.delayq.next,bad_tcb_t,delaynode)->counter;
 }
 
-BAD_RTOS_STATIC bad_tcb_t* __delayq_dequeue_head(){
-    bad_link_node_t *head = kernel_cb.delayq.next;
+// Consumes passed ticks from the deltas, returns 1 if anything expired
+BAD_RTOS_STATIC uint32_t __delayq_advance(uint32_t ticks){
+    bad_link_node_t *traverse = kernel_cb.delayq.next;
+    uint32_t expired = 0;
+    while(traverse && ticks){
+        bad_tcb_t *traverse_tcb = BAD_CONTAINER_OF(traverse,bad_tcb_t,delaynode);
+        if(traverse_tcb->counter > ticks){
+            traverse_tcb->counter -= ticks;
+            break;
+        }
+        ticks -= traverse_tcb->counter;
+        traverse_tcb->counter = 0;
+        expired = 1;
+        traverse = traverse->next;
+    }
+    return expired;
+}
+#endif
+
+#else
+// Hashed timing wheel, a delayed tcb sits in the slot of its wake tick and 
+// keeps the absolute wake tick in the counter field, later rounds share the slot
+#define BAD_RTOS_WHEEL_SLOT(tick) ((tick) & (BAD_RTOS_WHEEL_SLOTS - 1))
+
+BAD_RTOS_STATIC void __delayq_init(){
+    for (uint32_t i = 0; i < BAD_RTOS_WHEEL_SLOTS; i++){
+        kernel_cb.wheel[i].next = &kernel_cb.wheel[i];
+        kernel_cb.wheel[i].prev = &kernel_cb.wheel[i];
+    }
+}
+
+BAD_RTOS_STATIC void __delayq_enqueue(bad_tcb_t *tcb, uint32_t delay){
+    uint32_t wake_tick = kernel_cb.ticks + delay;
+    uint32_t slot = BAD_RTOS_WHEEL_SLOT(wake_tick);
+    bad_link_node_t *head = &kernel_cb.wheel[slot];
+    bad_link_node_t *tcb_delaynode_ptr = &tcb->delaynode;
+    
+    tcb_delaynode_ptr->next = head->next;
+    tcb_delaynode_ptr->prev = head;
+    head->next->prev = tcb_delaynode_ptr;
+    head->next = tcb_delaynode_ptr;
+    tcb->counter = wake_tick;
+    tcb->delayq_misc = BAD_RTOS_MISC_DELAYQ_MEMBER;
+    kernel_cb.wheel_bmask |= 1UL << slot;
+}
+
+BAD_RTOS_STATIC bad_rtos_status_t __delayq_dequeue(bad_tcb_t *tcb){
+    
+    if(tcb->delayq_misc == BAD_RTOS_MISC_NOT_DELAYED){
+        return BAD_RTOS_STATUS_WRONG_Q;
+    }
+    
+    bad_link_node_t *tcb_delaynode_ptr = &tcb->delaynode;
+    tcb_delaynode_ptr->prev->next = tcb_delaynode_ptr->next;
+    tcb_delaynode_ptr->next->prev = tcb_delaynode_ptr->prev;
+    uint32_t slot = BAD_RTOS_WHEEL_SLOT(tcb->counter);
+    kernel_cb.wheel_bmask &= ~((uint32_t)(kernel_cb.wheel[slot].next == &kernel_cb.wheel[slot]) << slot);
+    tcb_delaynode_ptr->next = 0;
+    tcb_delaynode_ptr->prev = 0;
+    tcb->counter = tcb->ticks_to_change; //counter held the wake tick
+    tcb->delayq_misc = BAD_RTOS_MISC_NOT_DELAYED;
+    return BAD_RTOS_STATUS_OK;
+}
+
+// Occupied slots between the last scan and the current tick
+BAD_RTOS_STATIC uint32_t __wheel_pending_slots(){
+    uint32_t unscanned = kernel_cb.ticks - kernel_cb.wheel_last;
+    if(unscanned >= BAD_RTOS_WHEEL_SLOTS){
+        return kernel_cb.wheel_bmask;
+    }
+    uint32_t first = BAD_RTOS_WHEEL_SLOT(kernel_cb.wheel_last + 1);
+    uint32_t span = (1UL << unscanned) - 1;
+    if(first){
+        span = (span << first) | (span >> (BAD_RTOS_WHEEL_SLOTS - first));
+    }
+    return kernel_cb.wheel_bmask & span;
+}
+
+BAD_RTOS_STATIC bad_tcb_t* __delayq_dequeue_expired(){
+    uint32_t pending = __wheel_pending_slots();
+    while(pending){
+        uint32_t slot = __builtin_ctz(pending);
+        pending &= pending - 1;
+        bad_link_node_t *head = &kernel_cb.wheel[slot];
+        for(bad_link_node_t *traverse = head->next; traverse != head; traverse = traverse->next){
+            bad_tcb_t *traverse_tcb = BAD_CONTAINER_OF(traverse,bad_tcb_t,delaynode);
+            if((int32_t)(traverse_tcb->counter - kernel_cb.ticks) <= 0){
+                __delayq_dequeue(traverse_tcb);
+                return traverse_tcb;
+            }
+        }
+    }
+    kernel_cb.wheel_last = kernel_cb.ticks;
+    return 0;
+}
+
+#ifdef BAD_RTOS_USE_TICKLESS_IDLE
+// Distance to the next occupied slot, entries there may belong to later rounds 
+// so this is only a lower bound, idle just goes back to sleep in that case
+BAD_RTOS_STATIC uint32_t __delayq_next_expiry(){
+    uint32_t occupied = kernel_cb.wheel_bmask;
+    if(!occupied){
+        return UINT32_MAX;
+    }
+    uint32_t first = BAD_RTOS_WHEEL_SLOT(kernel_cb.ticks + 1);
+    if(first){
+        occupied = (occupied >> first) | (occupied << (BAD_RTOS_WHEEL_SLOTS - first));
+    }
+    return __builtin_ctz(occupied) + 1;
+}
+
+BAD_RTOS_STATIC uint32_t __delayq_advance(uint32_t ticks){
+    (void)ticks;
+    return !!__wheel_pending_slots();
+}
+#endif
+
+#endif
+
+BAD_RTOS_STATIC bad_tcb_t* __prio_list_dequeue_head(bad_link_node_t *q){
+    bad_link_node_t *head = q->next;
     if(!head){
         return 0;
     }
     bad_link_node_t *new_head = head->next; 
-    kernel_cb.delayq.next = new_head;
+    q->next = new_head;
     if(new_head){
-        new_head->prev = &kernel_cb.delayq;
+        new_head->prev = q;
     }
-    bad_tcb_t *head_tcb = BAD_CONTAINER_OF(head,bad_tcb_t,delaynode);
-    head_tcb->delayq_misc = BAD_RTOS_MISC_NOT_DELAYED; 
+    bad_tcb_t *head_tcb = BAD_CONTAINER_OF(head,bad_tcb_t,qnode);
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    uint32_t level = BAD_WAITQ_LEVEL(head_tcb->wait_priority);
+    if(!new_head || BAD_WAITQ_LEVEL(BAD_CONTAINER_OF(new_head,bad_tcb_t,qnode)->wait_priority) != level){
+        BAD_WAITQ_INDEX(q)->bmask &= ~(1UL << level);
+    }
+#endif
     return head_tcb;
 }
 
@@ -2099,29 +4398,42 @@ BAD_RTOS_STATIC bad_rtos_status_t __remove_entry(bad_tcb_t *tcb,bad_rtos_misc_t
     return BAD_RTOS_STATUS_OK;
 }
 
-BAD_RTOS_STATIC void __isr_q_push(bad_isr_q_t *q,bad_isr_op_obj_t* msg){
-    bad_isr_op_obj_t *tail ;
-#ifdef BAD_RTOS_USE_MPU
-    uint32_t kernel_rlar = BAD_MPU->RLAR;
-    BAD_MPU->RLAR = kernel_rlar & ~(BAD_MPU_RLAR_EN);
-    __dsb();
-    __isb();
+// Removes a waiter from a synchro object wait queue (timeouts)
+BAD_RTOS_STATIC bad_rtos_status_t __prio_list_remove(bad_link_node_t *q,bad_tcb_t *tcb,bad_rtos_misc_t target){
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    if(tcb->misc != target){
+        return BAD_RTOS_STATUS_WRONG_Q;
+    }
+    uint32_t level = BAD_WAITQ_LEVEL(tcb->wait_priority);
+    bad_link_node_t *prev = tcb->qnode.prev;
+    bad_link_node_t *next = tcb->qnode.next;
+    if(!next || BAD_WAITQ_LEVEL(BAD_CONTAINER_OF(next,bad_tcb_t,qnode)->wait_priority) != level){
+        bad_tcb_t *prev_tcb = BAD_CONTAINER_OF(prev,bad_tcb_t,qnode);
+        if(prev != q && BAD_WAITQ_LEVEL(prev_tcb->wait_priority) == level){
+            BAD_WAITQ_INDEX(q)->tails[level] = __tcb_slab_get_idx_from_ptr(prev_tcb);
+        }else{
+            BAD_WAITQ_INDEX(q)->bmask &= ~(1UL << level);
+        }
+    }
+#else
+    (void)q;
 #endif
+    return __remove_entry(tcb,target);
+}
+
+BAD_RTOS_STATIC void __isr_q_push(bad_isr_q_t *q,bad_isr_node_t* msg){
+    bad_isr_node_t *tail ;
     msg->next = 0;
     do{
-        tail = (bad_isr_op_obj_t *)__ldrex((volatile uint32_t*)&q->head);
+        tail = (bad_isr_node_t *)__ldrex((volatile uint32_t*)&q->head);
     }while(__strex((uint32_t)msg,(volatile uint32_t *)&q->head));
     tail->next = msg;
     __dmb();
-#ifdef BAD_RTOS_USE_MPU
-    BAD_MPU->RLAR = kernel_rlar;
-    __dsb();
-#endif
 }
 
-BAD_RTOS_STATIC bad_isr_op_obj_t *__isr_q_pop(bad_isr_q_t *q){
-    bad_isr_op_obj_t *next =q->tail->next;
-    bad_isr_op_obj_t *tail = q->tail;
+BAD_RTOS_STATIC bad_isr_node_t *__isr_q_pop(bad_isr_q_t *q){
+    bad_isr_node_t *next =q->tail->next;
+    bad_isr_node_t *tail = q->tail;
     if(q->tail == &q->stub){
         if(!next){
             return 0;
@@ -2150,17 +4462,34 @@ BAD_RTOS_STATIC bad_isr_op_obj_t *__isr_q_pop(bad_isr_q_t *q){
     
 }
 
-BAD_RTOS_STATIC bad_rtos_status_t __kernel_notify(bad_isr_op_t op,void *arg){
-    bad_isr_op_obj_t *message = gpool_alloc();
-    if(!message){
-        return BAD_RTOS_STATUS_ALLOC_FAIL;
+// Ors ops into the embedded node of an object and queues it for pendsv, a node already 
+// in the queue only collects the new bits, pendsv applies all of them at once
+BAD_RTOS_STATIC void __kernel_notify(bad_isr_node_t *node, bad_isr_op_t op, void *arg, uint16_t ops){
+#ifdef BAD_RTOS_USE_MPU
+    uint32_t kernel_rlar = BAD_MPU->RLAR;
+    BAD_MPU->RLAR = kernel_rlar & ~(BAD_MPU_RLAR_EN);
+    __dsb();
+    __isb();
+#endif
+    uint16_t pending;
+    do{
+        pending = __ldrexh(&node->pending);
+        if((pending | ops) == pending){
+            __clrex();
+            break;
+        }
+    }while(__strexh(pending | ops, &node->pending));
+    if(!pending){
+        node->op_kind = op;
+        node->arg = arg;
+        __dmb();
+        __isr_q_push(&kernel_cb.isrq,node);
+        __scb_trigger_pendsv();
     }
-    message->op_kind = op;
-    message->arg = arg;
-    __dmb();
-    __isr_q_push(&kernel_cb.isrq,message);
-    __scb_trigger_pendsv();
-    return BAD_RTOS_STATUS_OK; 
+#ifdef BAD_RTOS_USE_MPU
+    BAD_MPU->RLAR = kernel_rlar;
+    __dsb();
+#endif
 }
 
 BAD_RTOS_STATIC void __sched_update(bad_tcb_t *tcb){
@@ -2168,18 +4497,24 @@ BAD_RTOS_STATIC void __sched_update(bad_tcb_t *tcb){
     tcb->misc = BAD_RTOS_MISC_RUNNING;
 }
 
+// Task that runs once the kernel exits, a switch picked earlier in the same kernel entry wins over curr
+BAD_RTOS_STATIC bad_tcb_t *__sched_running(){
+    return kernel_cb.next ? kernel_cb.next : kernel_cb.curr;
+}
+
 BAD_RTOS_STATIC void __sched_try_update(){
     uint32_t top_ready_prio = __get_top_ready_prio();
-    if(top_ready_prio < kernel_cb.curr->raised_priority && kernel_cb.is_unlocked){
-        __readyq_enqueue(kernel_cb.curr);
+    bad_tcb_t *running = __sched_running();
+    if(top_ready_prio < running->raised_priority && kernel_cb.is_unlocked){
+        __readyq_enqueue(running);
         __sched_update(__readyq_dequeue_head());
     }
 }
 
 BAD_RTOS_STATIC void __sched_try_preempt(bad_tcb_t *tcb){
-    
-    if(tcb->raised_priority < kernel_cb.curr->raised_priority && kernel_cb.is_unlocked){
-        __readyq_enqueue(kernel_cb.curr);
+    bad_tcb_t *running = __sched_running();
+    if(tcb->raised_priority < running->raised_priority && kernel_cb.is_unlocked){
+        __readyq_enqueue(running);
         __sched_update(tcb);
     }else {
         __readyq_enqueue(tcb);
@@ -2189,9 +4524,8 @@ BAD_RTOS_STATIC void __sched_try_preempt(bad_tcb_t *tcb){
 
 static void __attribute__((used)) __handle_systick_event(bad_systick_status_t status){
     if(status > 1){
-        do{ 
-            bad_tcb_t *wake = __delayq_dequeue_head();
-            
+        bad_tcb_t *wake;
+        while((wake = __delayq_dequeue_expired())){
             if(wake->cbptr){
                 bad_task_handle_t wake_handle = __tcb_slab_get_idx_from_ptr(wake) | 
                     BAD_TASK_HANDLE_GEN(wake->generation);
@@ -2202,8 +4536,7 @@ static void __attribute__((used)) __handle_systick_event(bad_systick_status_t st
             
             wake->counter = wake->ticks_to_change;
             __readyq_enqueue(wake);
-        }while(kernel_cb.delayq.next && !BAD_CONTAINER_OF(kernel_cb.delayq.next, bad_tcb_t, delaynode)->counter);
-        
+        }
     }
     if (status & BAD_SYSTICK_TIMEFRAME_PENDING) {
         kernel_cb.curr->counter = kernel_cb.curr->ticks_to_change;
@@ -2219,6 +4552,167 @@ static void __attribute__((used)) __handle_systick_event(bad_systick_status_t st
     }
 }
 
+#ifdef BAD_RTOS_USE_TICKLESS_IDLE
+#ifdef BAD_RTOS_USE_SHARED_TIME
+// Mirrors the tick count for the lock free readers, a wrap bumps both words with interrupts off
+// so readers in higher priority isrs never see a half updated count
+BAD_RTOS_STATIC void __shared_time_publish(uint32_t ticks, uint32_t wrapped){
+    if(wrapped){
+        __asm__ volatile("cpsid i":::"memory");
+        shared_time.ticks_lo = ticks;
+        shared_time.ticks_hi++;
+        __asm__ volatile("cpsie i":::"memory");
+        return;
+    }
+    shared_time.ticks_lo = ticks;
+}
+#endif
+
+// Applies ticks that passed while the tick was stopped, returns systick event status
+BAD_RTOS_STATIC uint32_t __tickless_advance(uint32_t ticks){
+    uint32_t status = 0;
+    kernel_cb.ticks += ticks;
+#ifdef BAD_RTOS_USE_SHARED_TIME
+    __shared_time_publish(kernel_cb.ticks, kernel_cb.ticks < ticks);
+#endif
+    
+    if(kernel_cb.curr->counter > ticks){
+        kernel_cb.curr->counter -= ticks;
+    }else if(ticks){
+        status |= BAD_SYSTICK_TIMEFRAME_PENDING;
+    }
+    
+    if(__delayq_advance(ticks)){
+        status |= BAD_SYSTICK_DELAY_WAKE_PENDING;
+    }
+    return status;
+}
+
+// Restarts the periodic tick aligned to the tick grid and compensates the kernel time
+BAD_RTOS_STATIC uint32_t __tickless_exit(){
+    uint32_t reload = kernel_cb.tickless_reload;
+    uint32_t ctrl = BAD_SYSTICK->CTRL; //clears countflag
+    BAD_SYSTICK->CTRL = ctrl & ~BAD_SYSTICK_CTRL_ENABLE;
+    uint32_t load = BAD_SYSTICK->LOAD + 1;
+    uint32_t elapsed = load - BAD_SYSTICK->VAL;
+    
+    if(ctrl & BAD_SYSTICK_CTRL_COUNTFLAG){
+        // long period ran out, the tick isr may be pending as well, this accounts for it 
+        elapsed += load;
+        BAD_SCB->ICSR = BAD_SCB_ICSR_PENDSTCLR;
+    }
+    
+    uint32_t total = kernel_cb.tickless_offset + elapsed;
+    uint32_t ticks = total / reload;
+    uint32_t next = reload - (total - ticks * reload);
+    
+    if(next < 2){ // tick boundary is too close to program it, skip over it
+        next += reload;
+        ticks++;
+    }
+    
+    BAD_SYSTICK->LOAD = next - 1;
+    BAD_SYSTICK->VAL = 0;
+    BAD_SYSTICK->CTRL = ctrl | BAD_SYSTICK_CTRL_ENABLE;
+    BAD_SYSTICK->LOAD = reload - 1; // takes effect on the next reload
+    kernel_cb.is_tickless = 0;
+    
+    return __tickless_advance(ticks);
+}
+
+BAD_RTOS_STATIC void __tickless_enter(){
+    if(kernel_cb.is_tickless){
+        // woken by an isr that didnt go through the kernel
+        uint32_t status = __tickless_exit();
+        if(status){
+            __handle_systick_event(status);
+            return;
+        }
+    }
+    
+    uint32_t idle_ticks = __delayq_next_expiry();
+    
+    if(idle_ticks < BAD_RTOS_TICKLESS_MIN_IDLE_TICKS || (BAD_SCB->ICSR & BAD_SCB_ICSR_PENDSTSET)){
+        return;
+    }
+    
+    uint32_t ctrl = BAD_SYSTICK->CTRL;
+    BAD_SYSTICK->CTRL = ctrl & ~BAD_SYSTICK_CTRL_ENABLE;
+    uint32_t reload = BAD_SYSTICK->LOAD + 1;
+    uint32_t val = BAD_SYSTICK->VAL;
+    
+    uint32_t max_ticks = (BAD_SYSTICK_MAX_LOAD - val) / reload + 1;
+    if(idle_ticks > max_ticks){
+        idle_ticks = max_ticks;
+    }
+    
+    BAD_SYSTICK->LOAD = val + (idle_ticks - 1) * reload - 1;
+    BAD_SYSTICK->VAL = 0;
+    BAD_SYSTICK->CTRL = ctrl | BAD_SYSTICK_CTRL_ENABLE;
+    
+    kernel_cb.tickless_reload = reload;
+    kernel_cb.tickless_offset = reload - val;
+    kernel_cb.is_tickless = 1;
+}
+
+static void __attribute__((used)) __handle_tickless_systick_event(){
+    __handle_systick_event(__tickless_exit());
+}
+#endif
+
+#ifdef BAD_RTOS_USE_SHARED_TIME
+uint64_t kernel_ticks64(){
+    uint32_t hi;
+    uint32_t lo;
+    do{
+        hi = shared_time.ticks_hi;
+        lo = shared_time.ticks_lo;
+    }while(hi != shared_time.ticks_hi);
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// Tick count scaled to systick cycles plus the cycles elapsed in the current tick
+// A pending systick means the counter already reloaded but the tick was not counted yet
+BAD_RTOS_STATIC uint64_t __kernel_timestamp(){
+    uint64_t ticks;
+    uint64_t stamp;
+    do{
+        ticks = kernel_ticks64();
+        uint32_t pending = BAD_SCB->ICSR & BAD_SCB_ICSR_PENDSTSET;
+        uint32_t val = BAD_SYSTICK->VAL;
+        if(!pending && (BAD_SCB->ICSR & BAD_SCB_ICSR_PENDSTSET)){
+            // reloaded between the reads
+            val = BAD_SYSTICK->VAL;
+            pending = 1;
+        }
+        uint32_t load = BAD_SYSTICK->LOAD;
+        uint32_t period = load + 1;
+        // can be slightly negative in the partial period right after tickless exit
+        int32_t elapsed = (int32_t)(load - val);
+#ifdef BAD_RTOS_USE_TICKLESS_IDLE
+        if(kernel_cb.is_tickless){
+            elapsed += (int32_t)kernel_cb.tickless_offset + 1;
+            period = kernel_cb.tickless_reload;
+        }
+#endif
+        if(pending && val){
+            elapsed += (int32_t)(load + 1);
+        }
+        stamp = ticks * period + (int64_t)elapsed;
+    }while(ticks != kernel_ticks64());
+    return stamp;
+}
+
+extern uint64_t __kernel_timestamp_svc();
+
+uint64_t kernel_timestamp(){
+    if(__get_ipsr() || !(__get_control() & 0x1)){
+        return __kernel_timestamp();
+    }
+    return __kernel_timestamp_svc();
+}
+#endif
+
 BAD_RTOS_STATIC uint32_t * __init_stack(taskptr task, uint32_t *stacktop,void *args){
     *--stacktop = 0x01000000UL;     // xPSR (Thumb bit set)
     *--stacktop = (uint32_t)task|0x1;   // PC
@@ -2235,6 +4729,209 @@ BAD_RTOS_STATIC uint32_t * __init_stack(taskptr task, uint32_t *stacktop,void *a
     return stacktop;
 }
 
+#ifdef BAD_RTOS_USE_STACK_WATERMARK
+#ifndef BAD_RTOS_STACK_SCAN_BATCH
+#define BAD_RTOS_STACK_SCAN_BATCH (32)
+#endif
+#ifndef BAD_RTOS_MSP_STACK_SIZE
+#define BAD_RTOS_MSP_STACK_SIZE (1024)
+#endif
+#ifndef BAD_RTOS_STACK_MARGIN
+#define BAD_RTOS_STACK_MARGIN (25)
+#endif
+#define BAD_STACK_PAINT (0xA5A5A5A5UL)
+
+// Idle scan position, slot BAD_RTOS_MAX_TASKS is the msp
+typedef struct{
+    uint32_t slot;
+    uint32_t pos; //words of that stack already checked from the bottom
+}bad_stack_scan_t;
+
+static bad_stack_scan_t __attribute__((section(".kernel_bss"))) stack_scan;
+static uint32_t __attribute__((section(".kernel_bss"))) msp_untouched;
+
+BAD_RTOS_STATIC void __stack_paint(uint32_t *bottom, uint32_t words){
+    for(uint32_t i = 0; i < words; i++){
+        bottom[i] = BAD_STACK_PAINT;
+    }
+}
+
+// Paints the msp below the frames of the running startup code, the first task start drops
+// those frames but they stay unpainted, so the report overestimates by the startup depth
+BAD_RTOS_STATIC void __msp_paint(){
+    uint32_t *bottom = (uint32_t *)(&__estack - BAD_RTOS_MSP_STACK_SIZE);
+    uint32_t *sp;
+    __asm__ volatile("mov %0, sp" : "=r"(sp));
+    if(sp > bottom + 16){
+        __stack_paint(bottom, sp - bottom - 16); //leave room for the frame of __stack_paint
+    }
+    msp_untouched = BAD_RTOS_MSP_STACK_SIZE >> 2;
+}
+
+// Checks up to budget words from where the last check stopped, the first written word from 
+// the bottom is the deepest the stack went, returns 1 once the untouched mark is reached
+BAD_RTOS_STATIC uint32_t __stack_scan(uint32_t *bottom, uint32_t *untouched, uint32_t *pos, uint32_t budget){
+    uint32_t end = *untouched;
+    if(*pos < end && end - *pos > budget){
+        end = *pos + budget;
+    }
+    for(uint32_t i = *pos; i < end; i++){
+        if(bottom[i] != BAD_STACK_PAINT){
+            *untouched = i;
+            return 1;
+        }
+    }
+    *pos = end;
+    return end >= *untouched;
+}
+
+BAD_RTOS_STATIC uint32_t __stack_slot_used(uint32_t slot){
+#if BAD_RTOS_MAX_TASKS > 32
+    return !(tcbslab.free_bitmask[slot >> 5] & (1UL << (slot & 31)));
+#else
+    return !(tcbslab.free_bitmask & (1UL << slot));
+#endif
+}
+
+// Finds the stack of the first used slot from slot on, the msp after the last task
+BAD_RTOS_STATIC uint32_t __stack_of(uint32_t slot, uint32_t **bottom, uint32_t **untouched, uint32_t *size){
+    for(; slot < BAD_RTOS_MAX_TASKS; slot++){
+        if(__stack_slot_used(slot)){
+            bad_tcb_t *tcb = &tcbslab.node_arr[slot];
+            *bottom = (uint32_t *)tcb->stack;
+            *untouched = &tcb->stack_untouched;
+            *size = tcb->stack_size;
+            return slot;
+        }
+    }
+    *bottom = (uint32_t *)(&__estack - BAD_RTOS_MSP_STACK_SIZE);
+    *untouched = &msp_untouched;
+    *size = BAD_RTOS_MSP_STACK_SIZE;
+    return BAD_RTOS_MAX_TASKS;
+}
+
+// Idle side, one batch of one stack per wakeup, all stacks in turn
+BAD_RTOS_STATIC void __stack_scan_batch(){
+    uint32_t *bottom, *untouched, size;
+    uint32_t slot = __stack_of(stack_scan.slot, &bottom, &untouched, &size);
+    if(slot != stack_scan.slot){
+        stack_scan.pos = 0; //skipped free slots
+    }
+    if(__stack_scan(bottom, untouched, &stack_scan.pos, BAD_RTOS_STACK_SCAN_BATCH)){
+        stack_scan.pos = 0;
+        slot = slot == BAD_RTOS_MAX_TASKS ? 0 : slot + 1;
+    }
+    stack_scan.slot = slot;
+}
+
+BAD_RTOS_STATIC uint32_t __stack_recommend(uint32_t used, uint32_t is_msp){
+    uint32_t size = used + used * BAD_RTOS_STACK_MARGIN / 100;
+    if(is_msp){
+        return (size + 7) & ~7U;
+    }
+#ifdef BAD_RTOS_USE_MPU
+    size = (size + 31) & ~31U; //same limits as TASK_STATIC_STACK, the guard region needs 32 byte steps
+    if(size < 128){
+        size = 128;
+    }
+#else
+    size = (size + 7) & ~7U;
+    if(size < 64){
+        size = 64;
+    }
+#endif
+    return size;
+}
+
+// Reports the stack of the first used slot from slot on, the msp after the last task
+BAD_RTOS_STATIC bad_rtos_status_t __stack_stats(uint32_t slot, bad_stack_stats_t *stats){
+    if(!stats){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    if(slot > BAD_RTOS_MAX_TASKS){
+        return BAD_RTOS_STATUS_HANDLE_INVALID;
+    }
+    uint32_t *bottom, *untouched, size;
+    uint32_t pos = 0;
+    slot = __stack_of(slot, &bottom, &untouched, &size);
+    __stack_scan(bottom, untouched, &pos, UINT32_MAX);
+    stats->handle = slot == BAD_RTOS_MAX_TASKS ? BAD_STACK_MSP : slot | (tcbslab.node_arr[slot].generation << 16);
+    stats->size = size;
+    stats->used = size - (*untouched << 2);
+    stats->recommended = __stack_recommend(stats->used, slot == BAD_RTOS_MAX_TASKS);
+    return BAD_RTOS_STATUS_OK;
+}
+
+bad_rtos_status_t stack_stats(bad_task_handle_t handle, bad_stack_stats_t *stats){
+    bad_rtos_status_t status = __svc_stack_stats(BAD_TASK_HANDLE_GET_IDX(handle), stats);
+    if(status != BAD_RTOS_STATUS_OK){
+        return status;
+    }
+    if(stats->handle != handle){
+        return BAD_RTOS_STATUS_HANDLE_INVALID; //the slot is free, the next stack was reported
+    }
+    return BAD_RTOS_STATUS_OK;
+}
+
+BAD_RTOS_STATIC void __report_u32(bad_putc_t putc, uint32_t value){
+    char digits[10];
+    uint32_t count = 0;
+    do{
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    }while(value);
+    while(count){
+        putc(digits[--count]);
+    }
+}
+
+BAD_RTOS_STATIC void __report_str(bad_putc_t putc, const char *str){
+    while(*str){
+        putc(*str++);
+    }
+}
+
+void stack_report(bad_putc_t putc){
+    bad_stack_stats_t stats;
+    uint32_t slot = 0;
+    __report_str(putc, "stack size used recommended\r\n");
+    while(__svc_stack_stats(slot, &stats) == BAD_RTOS_STATUS_OK){
+        if(stats.handle == BAD_STACK_MSP){
+            __report_str(putc, "msp");
+        }else if(!BAD_TASK_HANDLE_GET_IDX(stats.handle)){
+            __report_str(putc, "idle");
+        }else{
+            __report_str(putc, "task 0x");
+            for(int32_t shift = 28; shift >= 0; shift -= 4){
+                putc("0123456789abcdef"[(stats.handle >> shift) & 0xF]);
+            }
+        }
+        putc(' ');
+        __report_u32(putc, stats.size);
+        putc(' ');
+        __report_u32(putc, stats.used);
+        putc(' ');
+        __report_u32(putc, stats.recommended);
+        __report_str(putc, "\r\n");
+        if(stats.handle == BAD_STACK_MSP){
+            break;
+        }
+        slot = BAD_TASK_HANDLE_GET_IDX(stats.handle) + 1;
+    }
+}
+
+void semihost_putc(char c){
+    __asm__ volatile(
+                     "mov r0, #3     \n" //SYS_WRITEC
+                     "mov r1, %0     \n"
+                     "bkpt 0xAB      \n"
+                     :
+                     : "r"(&c)
+                     : "r0", "r1", "memory"
+                     );
+}
+#endif
+
 //Core isr api implementations
 bad_rtos_status_t task_unblock_from_isr(bad_task_handle_t handle){
     if(!__get_ipsr()){
@@ -2246,7 +4943,8 @@ bad_rtos_status_t task_unblock_from_isr(bad_task_handle_t handle){
         return BAD_RTOS_STATUS_HANDLE_INVALID;
     }
     
-    return __kernel_notify(BAD_ISR_OP_TASK_UNBLOCK,(void*)handle);
+    __kernel_notify(&tcb->isr_node,BAD_ISR_OP_TASK,(void*)handle,BAD_ISR_TASK_UNBLOCK);
+    return BAD_RTOS_STATUS_OK;
 }
 
 bad_rtos_status_t task_delay_cancel_from_isr(bad_task_handle_t handle){
@@ -2259,8 +4957,63 @@ bad_rtos_status_t task_delay_cancel_from_isr(bad_task_handle_t handle){
         return BAD_RTOS_STATUS_HANDLE_INVALID;
     }
     
-    return __kernel_notify(BAD_ISR_OP_TASK_DELAY_CANCEL,(void*)handle);
+    __kernel_notify(&tcb->isr_node,BAD_ISR_OP_TASK,(void*)handle,BAD_ISR_TASK_DELAY_CANCEL);
+    return BAD_RTOS_STATUS_OK;
+}
+
+#ifdef BAD_RTOS_USE_TASK_NOTIFY
+BAD_RTOS_STATIC void __notify_apply(bad_tcb_t *tcb, uint32_t bits, bad_notify_action_t action){
+    uint32_t value;
+    do{
+        value = __ldrex(&tcb->notify_value);
+        switch(action){
+            case BAD_NOTIFY_SET_BITS:{
+                value |= bits;
+                break;
+            }
+            case BAD_NOTIFY_INCREMENT:{
+                value++;
+                break;
+            }
+            default:{
+                value = bits;
+                break;
+            }
+        }
+    }while(__strex(value, &tcb->notify_value));
+}
+
+bad_rtos_status_t task_notify_from_isr(bad_task_handle_t handle, uint32_t bits, bad_notify_action_t action){
+    if(!__get_ipsr()){
+        return BAD_RTOS_STATUS_WRONG_CONTEXT;
+    }
+    
+    bad_tcb_t *tcb = __tcb_slab_get_ptr_from_idx(BAD_TASK_HANDLE_GET_IDX(handle));
+    if(!handle || !tcb || tcb->generation != BAD_TASK_HANDLE_GET_GEN(handle)){
+        return BAD_RTOS_STATUS_HANDLE_INVALID;
+    }
+    
+    if(action > BAD_NOTIFY_OVERWRITE){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+#ifdef BAD_RTOS_USE_MPU
+    uint32_t kernel_rlar = BAD_MPU->RLAR;
+    BAD_MPU->RLAR = kernel_rlar & ~(BAD_MPU_RLAR_EN);
+    __dsb();
+    __isb();
+#endif
+    __notify_apply(tcb, bits, action);
+#ifdef BAD_RTOS_USE_MPU
+    BAD_MPU->RLAR = kernel_rlar;
+    __dsb();
+#endif
+    // the wake itself needs the kernel
+    if(tcb->notify_value & tcb->notify_mask){
+        __kernel_notify(&tcb->isr_node,BAD_ISR_OP_TASK,(void*)handle,BAD_ISR_TASK_NOTIFY);
+    }
+    return BAD_RTOS_STATUS_OK;
 }
+#endif
 
 //Core api implenetations
 BAD_RTOS_STATIC bad_task_handle_t __task_make(bad_task_descr_t *args){
@@ -2325,7 +5078,24 @@ BAD_RTOS_STATIC bad_task_handle_t __task_make(bad_task_descr_t *args){
     new_task->raised_priority = args->base_priority;
     new_task->ticks_to_change = args->ticks_to_change;
     new_task->counter = args->ticks_to_change;
+#ifdef BAD_RTOS_USE_PERIODIC_TASKS
+    new_task->period = args->period;
+    new_task->last_release = kernel_cb.ticks;
+    new_task->overruns = 0;
+    new_task->max_lateness = 0;
+#endif
+#ifdef BAD_RTOS_USE_TASK_NOTIFY
+    new_task->notify_value = 0;
+    new_task->notify_mask = 0; //a wake still queued from the previous task finds nothing to wait for
+#endif
     
+#ifdef BAD_RTOS_USE_STACK_WATERMARK
+    __stack_paint((uint32_t *)new_task->stack, args->stack_size >> 2);
+    new_task->stack_untouched = args->stack_size >> 2;
+    if(stack_scan.slot == __tcb_slab_get_idx_from_ptr(new_task)){
+        stack_scan.pos = 0; //the idle scan was in the middle of the old stack
+    }
+#endif
     uint32_t *stack_top = (uint32_t *)(new_task->stack + args->stack_size);
     new_task->sp = __init_stack(new_task->entry, stack_top, args->args);
     
@@ -2335,7 +5105,7 @@ BAD_RTOS_STATIC bad_task_handle_t __task_make(bad_task_descr_t *args){
         __readyq_enqueue(new_task);
     }
     
-    uint8_t idx = __tcb_slab_get_idx_from_ptr(new_task);
+    uint32_t idx = __tcb_slab_get_idx_from_ptr(new_task);
     return (bad_task_handle_t)(idx | (new_task->generation << 16));
     
     err_release_msgq:
@@ -2350,6 +5120,18 @@ BAD_RTOS_STATIC bad_task_handle_t __task_make(bad_task_descr_t *args){
     return BAD_TASK_HANDLE_INVALID_HANDLE(status);
 }
 
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+// Basic tasks run to completion on their level runner, blocking one would stall the whole level
+BAD_RTOS_STATIC uint32_t __basic_task_running(){
+    for(uint32_t i = 0; i < BAD_RTOS_BASIC_LEVELS; i++){
+        if(basic_levels[i].running == kernel_cb.curr){
+            return 1;
+        }
+    }
+    return 0;
+}
+#endif
+
 BAD_RTOS_STATIC void  __task_block(){
     __enqueue_head(&kernel_cb.blockedq, kernel_cb.curr,BAD_RTOS_MISC_BLOCKEDQ_MEMBER);
     __sched_update(__readyq_dequeue_head());
@@ -2399,7 +5181,7 @@ BAD_RTOS_STATIC bad_rtos_status_t __task_yield(){
 
 BAD_RTOS_STATIC void __task_finish(){
 #ifdef BAD_RTOS_USE_MUTEX
-    if(kernel_cb.curr->mutex_count){ //trap when task want to finish without releasing mutexes
+    if(mutex_holds[kernel_cb.curr - tcbslab.node_arr]){ //trap when task want to finish without releasing mutexes
         __builtin_trap();
         return;
     }
@@ -2410,6 +5192,9 @@ BAD_RTOS_STATIC void __task_finish(){
         return;
     }
 #endif
+#ifdef BAD_RTOS_USE_KHEAP_MAGAZINES
+    __magazine_flush(kernel_cb.curr);
+#endif
 #if defined (BAD_RTOS_USE_KHEAP)
     if(kernel_cb.curr->dyn_stack){ //free the dynamically allocated stack 
         __kernel_free((void*)kernel_cb.curr->stack,kernel_cb.curr->stack_size);
@@ -2428,17 +5213,66 @@ BAD_RTOS_STATIC void __task_delay(uint32_t delay,cbptr cb, void* args){
     
 }
 
+#ifdef BAD_RTOS_USE_PERIODIC_TASKS
+BAD_RTOS_STATIC bad_rtos_status_t __task_delay_until(uint32_t *last_wake, uint32_t period){
+    if(!last_wake || !period){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    uint32_t release = *last_wake + period;
+    *last_wake = release;
+    int32_t remaining = (int32_t)(release - kernel_cb.ticks);
+    if(remaining < 0){
+        kernel_cb.curr->overruns++;
+        if((uint32_t)-remaining > kernel_cb.curr->max_lateness){
+            kernel_cb.curr->max_lateness = -remaining;
+        }
+        return BAD_RTOS_STATUS_OVERRUN;
+    }
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+    if(__basic_task_running()){
+        return BAD_RTOS_STATUS_WRONG_CONTEXT;
+    }
+#endif
+    if(remaining){
+        __task_delay(remaining, 0, 0);
+    }
+    return BAD_RTOS_STATUS_OK;
+}
+
+BAD_RTOS_STATIC bad_rtos_status_t __task_wait_period(){
+    if(!kernel_cb.curr->period){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    return __task_delay_until(&kernel_cb.curr->last_release, kernel_cb.curr->period);
+}
+
+BAD_RTOS_STATIC bad_rtos_status_t __task_period_stats(bad_task_handle_t handle, bad_period_stats_t *stats){
+    bad_tcb_t *tcb = __tcb_slab_get_ptr_from_idx(BAD_TASK_HANDLE_GET_IDX(handle));
+    if(!handle || !tcb || tcb->generation != BAD_TASK_HANDLE_GET_GEN(handle)){
+        return BAD_RTOS_STATUS_HANDLE_INVALID;
+    }
+    if(!stats){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    stats->period = tcb->period;
+    stats->overruns = tcb->overruns;
+    stats->max_lateness = tcb->max_lateness;
+    return BAD_RTOS_STATUS_OK;
+}
+#endif
+
 BAD_RTOS_STATIC void __kernel_start(){
     if(kernel_cb.is_running){
         __builtin_trap();
     }
     kernel_cb.is_running = 1;
     kernel_cb.is_unlocked = 1;
-    pool_init(&gpool,gpool_mem,sizeof(bad_isr_op_obj_t),sizeof(bad_isr_op_obj_t) * BAD_RTOS_GLOBAL_POOL_SIZE_IN_BYTES);
+    pool_init(&gpool,gpool_mem,sizeof(bad_gpool_block_t),BAD_RTOS_GLOBAL_POOL_SIZE_IN_BYTES);
     __set_control(0x1);
     __restore_basepri(0);
     __scb_set_core_interrupt_priority(BAD_SCB_SVC_INTR, BAD_SCB_LOWEST_PRIO);
     kernel_cb.curr = __readyq_dequeue_head();
+    shared_curr = kernel_cb.curr;
     __asm volatile("b __init_second_stage");
 }
 
@@ -2481,9 +5315,25 @@ BAD_RTOS_STATIC void __readyq_init(){
     }
 }
 
+#if defined(BAD_RTOS_USE_WORKQ) || defined(BAD_RTOS_USE_BASIC_TASKS)
+BAD_RTOS_STATIC void __run_q_init(bad_run_q_t *rq){
+    rq->q.head = &rq->q.stub;
+    rq->q.tail = &rq->q.stub;
+    rq->sem.init_flag = 1;
+}
+#endif
+
 BAD_RTOS_STATIC void __irq_q_init(){
     kernel_cb.isrq.head = &kernel_cb.isrq.stub;
     kernel_cb.isrq.tail = &kernel_cb.isrq.stub;
+#ifdef BAD_RTOS_USE_WORKQ
+    __run_q_init(&kernel_workq);
+#endif
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+    for(uint32_t i = 0; i < BAD_RTOS_BASIC_LEVELS; i++){
+        __run_q_init(&basic_levels[i].rq);
+    }
+#endif
 }
 
 BAD_RTOS_STATIC void __idle_task_init(){
@@ -2497,6 +5347,10 @@ BAD_RTOS_STATIC void __idle_task_init(){
     idle_tcb->counter = UINT32_MAX;
 #ifdef BAD_RTOS_USE_MPU
     idle_tcb->regions = idle_regions;
+#endif
+#ifdef BAD_RTOS_USE_STACK_WATERMARK
+    __stack_paint((uint32_t *)idle_stack, IDLE_TASK_STACK_SIZE >> 2);
+    idle_tcb->stack_untouched = IDLE_TASK_STACK_SIZE >> 2;
 #endif
     idle_tcb->sp = __init_stack(idle_task, (uint32_t *)idle_stack +(IDLE_TASK_STACK_SIZE/sizeof(uint32_t)),0);
     __readyq_enqueue(idle_tcb);
@@ -2511,10 +5365,28 @@ void bad_rtos_start(){
     __tcb_queue_slab_init();
     __irq_q_init();
     __readyq_init();
+#ifdef BAD_RTOS_USE_TIMING_WHEEL
+    __delayq_init();
+#endif
     __interrupt_init();
     __idle_task_init();
-#ifdef BAD_RTOS_USE_KHEAP
+#ifdef BAD_RTOS_USE_KHEAP_ARENAS
+    __kheap_arenas_init();
+#elif defined(BAD_RTOS_USE_KHEAP_TLSF)
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    kmem_counters.kheap_size = __tlsf_init(&kernel_tlsf, kheap, KHEAP_SIZE);
+#else
+    __tlsf_init(&kernel_tlsf, kheap, KHEAP_SIZE);
+#endif
+#elif defined(BAD_RTOS_USE_KHEAP)
     __buddy_init(&kernel_buddy, kheap, kfreelist, KMIN_ORDER, KMAX_ORDER, kbitmask);
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    kmem_counters.kheap_size = 1U << KMAX_ORDER;
+#endif
+#endif
+#if defined(BAD_RTOS_USE_KHEAP) && defined(BAD_RTOS_USE_HEAP_STATS)
+    kmem_counters.kheap_free = kmem_counters.kheap_size;
+    kmem_counters.kheap_min_free = kmem_counters.kheap_size;
 #endif
 #ifdef BAD_RTOS_USE_MPU
     __mpu_default_init();
@@ -2526,17 +5398,16 @@ void bad_rtos_start(){
     __fpu_init(BAD_RTOS_FPU_SETTINGS);
 #endif
     bad_user_init();
+#ifdef BAD_RTOS_USE_STACK_WATERMARK
+    __msp_paint();
+#endif
     __first_task_start();
     
 }
 
 //Synchro helpers
 
-BAD_RTOS_STATIC bad_tcb_t* __synchro_wake(bad_link_node_t *q,cbptr cb,bad_rtos_status_t status){
-    bad_tcb_t *tcb = __prio_list_dequeue_head(q);
-    if(!tcb){
-        return 0;
-    }
+BAD_RTOS_STATIC void __synchro_wake_tcb(bad_tcb_t *tcb,cbptr cb,bad_rtos_status_t status){
     if(tcb->cbptr == cb){
         __delayq_dequeue(tcb);
         tcb->cbptr = 0;
@@ -2544,6 +5415,14 @@ BAD_RTOS_STATIC bad_tcb_t* __synchro_wake(bad_link_node_t *q,cbptr cb,bad_rtos_s
     }
     *(tcb->sp+9) = status;
     __sched_try_preempt(tcb);
+}
+
+BAD_RTOS_STATIC bad_tcb_t* __synchro_wake(bad_link_node_t *q,cbptr cb,bad_rtos_status_t status){
+    bad_tcb_t *tcb = __prio_list_dequeue_head(q);
+    if(!tcb){
+        return 0;
+    }
+    __synchro_wake_tcb(tcb,cb,status);
     return tcb;
 }
 
@@ -2562,6 +5441,9 @@ BAD_RTOS_STATIC void __synchro_wake_all(bad_link_node_t *q,cbptr cb, uint32_t st
         traverse_tcb = BAD_CONTAINER_OF(traverse, bad_tcb_t, qnode);
     }
     *q = (bad_link_node_t){0};
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    BAD_WAITQ_INDEX(q)->bmask = 0;
+#endif
     __sched_try_update();
 }
 
@@ -2569,6 +5451,11 @@ BAD_RTOS_STATIC  bad_rtos_status_t __synchro_block(bad_link_node_t *q, cbptr cb,
     if(delay == UINT32_MAX){
         return BAD_RTOS_STATUS_WOULD_BLOCK;
     }
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+    if(__basic_task_running()){
+        return BAD_RTOS_STATUS_WRONG_CONTEXT;
+    }
+#endif
     
     if(delay){
         kernel_cb.curr->args = q; //every synchro obj has blockedq as first element
@@ -2581,13 +5468,92 @@ BAD_RTOS_STATIC  bad_rtos_status_t __synchro_block(bad_link_node_t *q, cbptr cb,
     return BAD_RTOS_STATUS_OK;
 }
 
+#ifdef BAD_RTOS_USE_TASK_NOTIFY
+BAD_RTOS_STATIC void __task_notify_timeout_cb(bad_task_handle_t handle ,void *args){
+    (void)args;
+    bad_tcb_t *tcb = __tcb_slab_get_ptr_from_idx(BAD_TASK_HANDLE_GET_IDX(handle));
+    tcb->notify_mask = 0;
+    *(tcb->sp+9)=BAD_RTOS_STATUS_TIMEOUT;
+}
+
+// takes the waited bits out of the notification word, returns the word as it was before
+BAD_RTOS_STATIC uint32_t __task_notify_take(bad_tcb_t *tcb){
+    uint32_t value;
+    do{
+        value = __ldrex(&tcb->notify_value);
+    }while(__strex(value & ~tcb->notify_mask, &tcb->notify_value));
+    tcb->notify_mask = 0;
+    return value;
+}
+
+BAD_RTOS_STATIC void __task_notify_check(bad_tcb_t *tcb){
+    if(tcb->misc != BAD_RTOS_MISC_NOTIFY_WAIT || !(tcb->notify_value & tcb->notify_mask)){
+        return;
+    }
+    uint32_t value = __task_notify_take(tcb);
+    uint32_t *writeback = (uint32_t *)*(tcb->sp+11);
+    if(writeback){
+        *writeback = value;
+    }
+    __synchro_wake_tcb(tcb, __task_notify_timeout_cb, BAD_RTOS_STATUS_OK);
+}
+
+BAD_RTOS_STATIC bad_rtos_status_t __task_notify(bad_task_handle_t handle, uint32_t bits, bad_notify_action_t action){
+    bad_tcb_t *tcb = __tcb_slab_get_ptr_from_idx(BAD_TASK_HANDLE_GET_IDX(handle));
+    if(!handle || !tcb || tcb->generation != BAD_TASK_HANDLE_GET_GEN(handle)){
+        return BAD_RTOS_STATUS_HANDLE_INVALID;
+    }
+    if(action > BAD_NOTIFY_OVERWRITE){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    __notify_apply(tcb, bits, action);
+    __task_notify_check(tcb);
+    return BAD_RTOS_STATUS_OK;
+}
+
+BAD_RTOS_STATIC bad_rtos_status_t __task_notify_wait(uint32_t mask, uint32_t delay, uint32_t *value){
+    if(!mask){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    bad_tcb_t *curr = kernel_cb.curr;
+    // publish the mask first so an isr notifying from here on queues the wake
+    curr->notify_mask = mask;
+    __dmb();
+    if(curr->notify_value & mask){
+        uint32_t taken = __task_notify_take(curr);
+        if(value){
+            *value = taken;
+        }
+        return BAD_RTOS_STATUS_OK;
+    }
+    if(delay == UINT32_MAX){
+        curr->notify_mask = 0;
+        return BAD_RTOS_STATUS_WOULD_BLOCK;
+    }
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+    if(__basic_task_running()){
+        curr->notify_mask = 0;
+        return BAD_RTOS_STATUS_WRONG_CONTEXT;
+    }
+#endif
+    
+    if(delay){
+        curr->args = 0;
+        curr->cbptr = __task_notify_timeout_cb;
+        __delayq_enqueue(curr, delay);
+    }
+    __sched_update(__readyq_dequeue_head());
+    curr->misc = BAD_RTOS_MISC_NOTIFY_WAIT;
+    return BAD_RTOS_STATUS_OK;
+}
+#endif
+
 // Synchro objects api implenetations
 #ifdef BAD_RTOS_USE_MSGQ
 
 BAD_RTOS_STATIC void __msgq_timeout_cb(bad_task_handle_t handle ,void *msgq){
-    (void)msgq;
     bad_tcb_t *tcb = __tcb_slab_get_ptr_from_idx(BAD_TASK_HANDLE_GET_IDX(handle));
-    __remove_entry(tcb,BAD_RTOS_MISC_MSGQ_BLOCKEDQ_MEMBER);
+    __prio_list_remove(msgq,tcb,BAD_RTOS_MISC_MSGQ_BLOCKEDQ_MEMBER);
     *(tcb->sp+9)=BAD_RTOS_STATUS_TIMEOUT;
 }
 
@@ -2610,6 +5576,12 @@ BAD_RTOS_STATIC bad_rtos_status_t __msgq_acquire_allocate(bad_msgq_t *q,uint32_t
     q->owner = kernel_cb.curr;
     q->dynamic = 1;
     q->blockedq = (bad_link_node_t){0};
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    q->waitq_index.bmask = 0;
+#endif
+#ifdef BAD_RTOS_USE_COROUTINES
+    q->waitset = (bad_coro_bind_t){0};
+#endif
     q->head = q->tail = 0;
     BAD_OPT_BARRIER;
     q->capacity = capacity;
@@ -2631,7 +5603,17 @@ BAD_RTOS_STATIC bad_rtos_status_t __msgq_release_deallocate(bad_msgq_t *q){
     BAD_OPT_BARRIER;
     __kernel_free(q->msgs,capacity);
     __synchro_wake_all(&q->blockedq,__msgq_timeout_cb,BAD_RTOS_STATUS_DELETED);
-    *q = (bad_msgq_t){0};
+    // isr_node may still sit in the isr queue, leave it linked
+    q->owner = 0;
+    q->msgs = 0;
+    q->dynamic = 0;
+    q->writing = 0;
+    q->writer = 0;
+    q->boosted = 0;
+    q->boost_priority = 0;
+    q->boost_restore = 0;
+    volatile uint32_t *atomic_update = (volatile uint32_t *)&q->head;
+    *atomic_update = 0;
     return BAD_RTOS_STATUS_OK;
 }
 
@@ -2672,6 +5654,44 @@ BAD_RTOS_STATIC bad_rtos_status_t __msgq_release(bad_msgq_t *q){
     return BAD_RTOS_STATUS_OK;
 }
 
+// Tail slot holds a message, a thread mode post may have reserved it without writing it yet
+BAD_RTOS_STATIC uint32_t __msgq_can_pull(bad_msgq_t *q){
+    uint16_t tail = q->tail;
+    return tail != q->head && q->writing != tail + 1;
+}
+
+// Finds the owner or the first publisher in the blocked queue, both can wait at once when 
+// the owner blocked on a slot a thread mode post has not written yet
+BAD_RTOS_STATIC bad_tcb_t* __msgq_find_waiter(bad_msgq_t *q, uint32_t owner){
+    bad_link_node_t *traverse = q->blockedq.next;
+    while(traverse){
+        bad_tcb_t *tcb = BAD_CONTAINER_OF(traverse, bad_tcb_t, qnode);
+        if((tcb == q->owner) == owner){
+            return tcb;
+        }
+        traverse = traverse->next;
+    }
+    return 0;
+}
+
+BAD_RTOS_STATIC void __msgq_wake(bad_msgq_t *q, bad_tcb_t *tcb){
+    __prio_list_remove(&q->blockedq,tcb,BAD_RTOS_MISC_MSGQ_BLOCKEDQ_MEMBER);
+    __synchro_wake_tcb(tcb,__msgq_timeout_cb,BAD_RTOS_STATUS_OK);
+}
+
+// The owner is about to block on a slot a preempted thread mode post reserved, the writer gets the
+// owner priority until its commit so tasks in between cant hold the owner up
+BAD_RTOS_STATIC void __msgq_boost_writer(bad_msgq_t *q){
+    bad_tcb_t *writer = (bad_tcb_t *)q->writer;
+    if(!writer || q->writing != q->tail + 1 || writer->raised_priority <= kernel_cb.curr->raised_priority){
+        return;
+    }
+    q->boost_restore = writer->raised_priority;
+    q->boost_priority = kernel_cb.curr->raised_priority;
+    q->boosted = (uint32_t)writer;
+    __task_set_raised_priority(writer, kernel_cb.curr->raised_priority);
+}
+
 bad_rtos_status_t __msgq_pull_msg(bad_msgq_t *q, bad_msg_block_t *writeback,uint32_t delay){
     if(!q || !writeback){
         return BAD_RTOS_STATUS_BAD_PARAMETERS;
@@ -2685,7 +5705,10 @@ bad_rtos_status_t __msgq_pull_msg(bad_msgq_t *q, bad_msg_block_t *writeback,uint
         return BAD_RTOS_STATUS_NOT_OWNER;
     }
     
-    if(q->tail==q->head){
+    if(!__msgq_can_pull(q)){
+        if(delay != UINT32_MAX){
+            __msgq_boost_writer(q);
+        }
         return __synchro_block(&q->blockedq,__msgq_timeout_cb,delay, BAD_RTOS_MISC_MSGQ_BLOCKEDQ_MEMBER);
     }
     
@@ -2711,13 +5734,58 @@ bad_rtos_status_t __msgq_pull_msg(bad_msgq_t *q, bad_msg_block_t *writeback,uint
 }
 
 BAD_RTOS_STATIC void __msgq_try_wake(bad_msgq_t *q){
-    bad_tcb_t *tcb = __synchro_wake(&q->blockedq,__msgq_timeout_cb,BAD_RTOS_STATUS_OK);
+    if(!__msgq_can_pull(q)){ // the thread mode post wakes the owner once it has written the slot
+        return;
+    }
+    bad_tcb_t *tcb = __msgq_find_waiter(q,1);
     if(tcb){ 
         bad_msg_block_t *writeback = (bad_msg_block_t *)*(tcb->sp + 10);
         *writeback = *(q->msgs+q->tail);
         BAD_OPT_BARRIER;
         q->tail = (q->tail+1) & (q->capacity-1);
+        __msgq_wake(q,tcb);
+    }
+}
+
+// Posts the message of the highest priority blocked publisher if there is space
+BAD_RTOS_STATIC void __msgq_try_wake_publisher(bad_msgq_t *q){
+    bad_tcb_t *tcb = __msgq_find_waiter(q,0);
+    if(!tcb){
+        return;
+    }
+    uint16_t head,next_head;
+    do{
+        head = __ldrexh(&q->head);
+        next_head = (head+1) & (q->capacity-1);
+        if(q->tail == next_head){
+            __clrex();
+            return;
+        }
+    }while(__strexh(next_head, &q->head)); 
+    
+    bad_msg_block_t* block = q->msgs+head;
+    block->signal = *(tcb->sp+10);
+    block->args = (void *)*(tcb->sp+11);
+    __msgq_wake(q,tcb);
+#ifdef BAD_RTOS_USE_COROUTINES
+    bad_sem_t *waitset = q->waitset.signal;
+    if(waitset){
+        __sem_put(waitset);
+    }
+#endif
+}
+
+// Called by the thread mode paths when they left the queue in a state someone blocked on may be waiting for
+BAD_RTOS_STATIC void __msgq_commit(bad_msgq_t *q){
+    if(q->boosted == (uint32_t)kernel_cb.curr){ // back to the own priority before the owner wake decides who runs
+        q->boosted = 0;
+        if(kernel_cb.curr->raised_priority == q->boost_priority){ //a mutex waiter raising it further keeps its boost
+            kernel_cb.curr->raised_priority = q->boost_restore;
+        }
     }
+    __msgq_try_wake(q);
+    __msgq_try_wake_publisher(q);
+    __sched_try_update();
 }
 
 bad_rtos_status_t __msgq_post_msg(bad_msgq_t *q, uint32_t signal, void *args,uint32_t delay){
@@ -2748,6 +5816,109 @@ bad_rtos_status_t __msgq_post_msg(bad_msgq_t *q, uint32_t signal, void *args,uin
     if(head == q->tail){
         __msgq_try_wake(q); 
     }
+#ifdef BAD_RTOS_USE_COROUTINES
+    bad_sem_t *waitset = q->waitset.signal;
+    if(waitset){
+        __sem_put(waitset);
+    }
+#endif
+    return BAD_RTOS_STATUS_OK;
+}
+
+bad_rtos_status_t msgq_post_msg(bad_msgq_t *q, uint32_t signal, void *args, uint32_t delay){
+    if(__get_ipsr()){
+        return BAD_RTOS_STATUS_WRONG_CONTEXT;
+    }
+    
+    if(!q){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    
+    if(!q->capacity){
+        return BAD_RTOS_STATUS_NOT_INITIALISED;
+    }
+    
+    uint16_t head,next_head;
+    // one thread mode writer at a time, it takes the writer word so the owner knows whom to boost
+    // and marks the slot it writes so the owner doesnt pull it early
+    do{
+        if(__ldrex(&q->writer) || q->blockedq.next){
+            __clrex();
+            return __svc_msgq_post_msg(q,signal,args,delay);
+        }
+    }while(__strex((uint32_t)shared_curr, &q->writer));
+    head = q->head;
+    q->writing = head+1;
+    
+    // isrs and the kernel can still post in front of the marked slot
+    for(;;){
+        next_head = (head+1) & (q->capacity-1);
+        if(q->tail == next_head){
+            q->writing = 0;
+            q->writer = 0;
+            if(q->blockedq.next || q->boosted == (uint32_t)shared_curr){
+                __svc_msgq_commit(q);
+            }
+            return __svc_msgq_post_msg(q,signal,args,delay);
+        }
+        if(__ldrexh(&q->head) == head && !__strexh(next_head, &q->head)){
+            break;
+        }
+        __clrex();
+        head = q->head;
+        q->writing = head+1;
+    }
+    
+    bad_msg_block_t* block = q->msgs+head;
+    
+    block->signal = signal;
+    block->args = args;
+    BAD_OPT_BARRIER;
+    q->writing = 0;
+    q->writer = 0; // the owner cant boost from here on, a boost it gave is already flagged
+    if(q->blockedq.next || q->boosted == (uint32_t)shared_curr){ // owner blocked while the slot was being written
+        __svc_msgq_commit(q);
+    }
+#ifdef BAD_RTOS_USE_COROUTINES
+    bad_sem_t *waitset = q->waitset.signal;
+    if(waitset){
+        sem_put(waitset);
+    }
+#endif
+    return BAD_RTOS_STATUS_OK;
+}
+
+bad_rtos_status_t msgq_pull_msg(bad_msgq_t *q, bad_msg_block_t *writeback, uint32_t delay){
+    if(__get_ipsr()){
+        return BAD_RTOS_STATUS_WRONG_CONTEXT;
+    }
+    
+    if(!q || !writeback){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    
+    if(!q->capacity){
+        return BAD_RTOS_STATUS_NOT_INITIALISED;
+    }
+    
+    if(q->owner != shared_curr){
+        return BAD_RTOS_STATUS_NOT_OWNER;
+    }
+    
+    uint16_t tail = q->tail;
+    if(tail == q->head || q->writing == tail + 1){
+        if(delay == UINT32_MAX){
+            return BAD_RTOS_STATUS_WOULD_BLOCK;
+        }
+        return __svc_msgq_pull_msg(q,writeback,delay);
+    }
+    
+    *writeback = *(q->msgs+tail);
+    BAD_OPT_BARRIER;
+    q->tail = (tail+1) & (q->capacity-1);
+    if(q->blockedq.next){ // publishers blocked on a full queue
+        __svc_msgq_commit(q);
+    }
     return BAD_RTOS_STATUS_OK;
 }
 
@@ -2781,8 +5952,14 @@ bad_rtos_status_t msgq_post_msg_from_isr(bad_msgq_t *q, uint32_t signal, void *a
     block->signal = signal;
     block->args = args;
     if(q->tail == head){// we may have preempted the consumer mid block, need to check in pendsv
-        return __kernel_notify(BAD_ISR_OP_MSGQ_WAKE,q);
+        __kernel_notify(&q->isr_node,BAD_ISR_OP_MSGQ_WAKE,q,1);
+    }
+#ifdef BAD_RTOS_USE_COROUTINES
+    bad_sem_t *waitset = q->waitset.signal;
+    if(waitset){
+        sem_put_from_isr(waitset);
     }
+#endif
     return BAD_RTOS_STATUS_OK;
     
 }
@@ -2801,58 +5978,82 @@ bad_rtos_status_t mutex_init(bad_mutex_t *mut){
 }
 
 BAD_RTOS_STATIC void __mutex_timeout_cb(bad_task_handle_t handle ,void *mutex){
-    (void)mutex;
     bad_tcb_t *tcb = __tcb_slab_get_ptr_from_idx(BAD_TASK_HANDLE_GET_IDX(handle));
-    __remove_entry(tcb,BAD_RTOS_MISC_MUTEX_BLOCKEDQ_MEMBER);
+    __prio_list_remove(mutex,tcb,BAD_RTOS_MISC_MUTEX_BLOCKEDQ_MEMBER);
     *(tcb->sp+9)=BAD_RTOS_STATUS_TIMEOUT;
 }
 
+#define BAD_MUTEX_OWNER(mut) ((bad_tcb_t *)((mut)->owner & ~BAD_MUTEX_WAITERS))
+
+// Whoever moves the owner word counts it, the kernel side cant race the owners own ldrex/strex
+// since the svc entry clears the monitor
+BAD_RTOS_STATIC void __mutex_count_hold(bad_tcb_t *tcb, uint32_t delta){
+    volatile uint32_t *holds = &mutex_holds[tcb - tcbslab.node_arr];
+    uint32_t value;
+    do{
+        value = __ldrex(holds) + delta;
+    }while(__strex(value, holds));
+}
+
 BAD_RTOS_STATIC bad_rtos_status_t __mutex_delete(bad_mutex_t *mut){
     if(!mut){
         return BAD_RTOS_STATUS_BAD_PARAMETERS;
     }
-    if(kernel_cb.curr != mut->owner ){
+    if(kernel_cb.curr != BAD_MUTEX_OWNER(mut)){
         return BAD_RTOS_STATUS_NOT_OWNER;
     }
     
-    kernel_cb.curr->mutex_count--;
-    if(!kernel_cb.curr->mutex_count){
-        kernel_cb.curr->raised_priority = kernel_cb.curr->base_priority;
+    if(mut->owner & BAD_MUTEX_WAITERS){
+        kernel_cb.curr->mutex_count--;
+        if(!kernel_cb.curr->mutex_count){
+            kernel_cb.curr->raised_priority = kernel_cb.curr->base_priority;
+        }
     }
     
     
     __synchro_wake_all(&mut->blockedq,__mutex_timeout_cb,BAD_RTOS_STATUS_DELETED);
+    __mutex_count_hold(kernel_cb.curr, (uint32_t)-1);
     
     *mut = (bad_mutex_t){0};
     
     return BAD_RTOS_STATUS_OK;
 }
 
-BAD_RTOS_STATIC void __mutex_update_owner_pos(bad_tcb_t *owner){
-    if(owner->misc == BAD_RTOS_MISC_READYQ_MEMBER){
-        __remove_entry(owner,BAD_RTOS_MISC_READYQ_MEMBER);
-        __readyq_enqueue(owner);
-    }
-}
-
+// Only contended mutexes end up here, owner word is written with plain stores since the svc entry 
+// cleared the exclusive monitor and any fast path strex in flight fails and retries
+// The owners mutex_count counts the mutexes with BAD_MUTEX_WAITERS set for the priority restore, mutex_holds counts all of them
 BAD_RTOS_STATIC bad_rtos_status_t __mutex_take(bad_mutex_t *mut, uint32_t delay){
     if(!mut){
         return BAD_RTOS_STATUS_BAD_PARAMETERS;
     }
-    if(!mut->owner){
-        mut->owner = kernel_cb.curr;
-        kernel_cb.curr->mutex_count++;
+    bad_tcb_t *owner = BAD_MUTEX_OWNER(mut);
+    if(!owner){ // put by the owner before the svc got here
+        mut->owner = (uint32_t)kernel_cb.curr;
+        __mutex_count_hold(kernel_cb.curr, 1);
         return BAD_RTOS_STATUS_OK;
     }
     
-    if(mut->owner == kernel_cb.curr){
+    if(owner == kernel_cb.curr){
         mut->rec_takes++;
         return BAD_RTOS_STATUS_OK;
     }
     
-    if(kernel_cb.curr->raised_priority < mut->owner->raised_priority){
-        mut->owner->raised_priority = kernel_cb.curr->raised_priority;
-        __mutex_update_owner_pos(mut->owner);
+    if(delay == UINT32_MAX){
+        return BAD_RTOS_STATUS_WOULD_BLOCK;
+    }
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+    if(__basic_task_running()){ //before the owner gets boosted for a waiter that never comes
+        return BAD_RTOS_STATUS_WRONG_CONTEXT;
+    }
+#endif
+    
+    if(!(mut->owner & BAD_MUTEX_WAITERS)){
+        mut->owner |= BAD_MUTEX_WAITERS;
+        owner->mutex_count++;
+    }
+    
+    if(kernel_cb.curr->raised_priority < owner->raised_priority){
+        __task_set_raised_priority(owner, kernel_cb.curr->raised_priority);
     }
     
     return __synchro_block(&mut->blockedq,__mutex_timeout_cb,delay, BAD_RTOS_MISC_MUTEX_BLOCKEDQ_MEMBER);
@@ -2863,7 +6064,7 @@ BAD_RTOS_STATIC bad_rtos_status_t __mutex_put(bad_mutex_t *mut){
         return BAD_RTOS_STATUS_BAD_PARAMETERS;
     }
     
-    if(kernel_cb.curr!= mut->owner){
+    if(kernel_cb.curr != BAD_MUTEX_OWNER(mut)){
         return BAD_RTOS_STATUS_NOT_OWNER;
     }
     
@@ -2872,17 +6073,88 @@ BAD_RTOS_STATIC bad_rtos_status_t __mutex_put(bad_mutex_t *mut){
         return BAD_RTOS_STATUS_OK;
     }
     
-    mut->owner =  __synchro_wake(&mut->blockedq,__mutex_timeout_cb,BAD_RTOS_STATUS_OK);
+    uint32_t contended = mut->owner & BAD_MUTEX_WAITERS;
+    bad_tcb_t *next = __synchro_wake(&mut->blockedq,__mutex_timeout_cb,BAD_RTOS_STATUS_OK);
     
-    if(!--kernel_cb.curr->mutex_count){
+    if(contended && !--kernel_cb.curr->mutex_count){
         kernel_cb.curr->raised_priority = kernel_cb.curr->base_priority;
     }
+    __mutex_count_hold(kernel_cb.curr, (uint32_t)-1);
     
-    if(!mut->owner){ 
+    if(!next){ // the waiters timed out
+        mut->owner = 0;
         return BAD_RTOS_STATUS_OK; 
     }
-    mut->owner->mutex_count++;    
+    __mutex_count_hold(next, 1);
+    
+    if(!mut->blockedq.next){ // last waiter, the new owner can put it in thread mode
+        mut->owner = (uint32_t)next;
+        return BAD_RTOS_STATUS_OK;
+    }
+    
+    mut->owner = (uint32_t)next | BAD_MUTEX_WAITERS;
+    next->mutex_count++;    
+    
+    return BAD_RTOS_STATUS_OK;
+}
+
+bad_rtos_status_t mutex_take(bad_mutex_t *mut,uint32_t delay){
+    if(__get_ipsr()){
+        return BAD_RTOS_STATUS_WRONG_CONTEXT;
+    }
+    
+    if(!mut){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    
+    uint32_t self = (uint32_t)shared_curr;
+    uint32_t owner;
+    do{
+        owner = __ldrex(&mut->owner);
+        if(owner){
+            __clrex();
+            if((owner & ~BAD_MUTEX_WAITERS) == self){
+                mut->rec_takes++;
+                return BAD_RTOS_STATUS_OK;
+            }
+            if(delay == UINT32_MAX){
+                return BAD_RTOS_STATUS_WOULD_BLOCK;
+            }
+            return __svc_mutex_take(mut,delay);
+        }
+    }while(__strex(self, &mut->owner));
+    __mutex_count_hold((bad_tcb_t *)self, 1);
+    return BAD_RTOS_STATUS_OK;
+}
+
+bad_rtos_status_t mutex_put(bad_mutex_t *mut){
+    if(__get_ipsr()){
+        return BAD_RTOS_STATUS_WRONG_CONTEXT;
+    }
+    
+    if(!mut){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
     
+    uint32_t self = (uint32_t)shared_curr;
+    uint32_t owner;
+    do{
+        owner = __ldrex(&mut->owner);
+        if((owner & ~BAD_MUTEX_WAITERS) != self){
+            __clrex();
+            return BAD_RTOS_STATUS_NOT_OWNER;
+        }
+        if(mut->rec_takes){
+            __clrex();
+            mut->rec_takes--;
+            return BAD_RTOS_STATUS_OK;
+        }
+        if(owner & BAD_MUTEX_WAITERS){
+            __clrex();
+            return __svc_mutex_put(mut);
+        }
+    }while(__strex(0, &mut->owner));
+    __mutex_count_hold((bad_tcb_t *)self, (uint32_t)-1);
     return BAD_RTOS_STATUS_OK;
 }
 #endif
@@ -2893,15 +6165,20 @@ bad_rtos_status_t sem_init(bad_sem_t *sem, uint32_t reset_value){
         return BAD_RTOS_STATUS_BAD_PARAMETERS;
     }
     sem->blockedq = (bad_link_node_t){0};
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    sem->waitq_index.bmask = 0;
+#endif
+#ifdef BAD_RTOS_USE_COROUTINES
+    sem->waitset = (bad_coro_bind_t){0};
+#endif
     sem->counter = reset_value;
     sem->init_flag = 1;
     return BAD_RTOS_STATUS_OK;
 }
 
 BAD_RTOS_STATIC void __sem_timeout_cb(bad_task_handle_t handle ,void *semaphore){
-    (void)semaphore;
     bad_tcb_t *tcb = __tcb_slab_get_ptr_from_idx(BAD_TASK_HANDLE_GET_IDX(handle));
-    __remove_entry(tcb,BAD_RTOS_MISC_SEM_BLOCKEDQ_MEMBER);
+    __prio_list_remove(semaphore,tcb,BAD_RTOS_MISC_SEM_BLOCKEDQ_MEMBER);
     *(tcb->sp+9)=BAD_RTOS_STATUS_TIMEOUT;
 }
 
@@ -2920,7 +6197,8 @@ BAD_RTOS_STATIC bad_rtos_status_t __sem_delete(bad_sem_t *sem){
     
     __synchro_wake_all(&sem->blockedq,__sem_timeout_cb,BAD_RTOS_STATUS_DELETED);
     
-    *sem = (bad_sem_t){0};
+    sem->counter = 0; // isr_node may still sit in the isr queue, leave it linked
+    sem->init_flag = 0;
     
     return BAD_RTOS_STATUS_OK;
 }
@@ -2966,6 +6244,12 @@ bad_rtos_status_t sem_put(bad_sem_t *sem){
         }
     }while(__strex(counter+1, &sem->counter));
     
+#ifdef BAD_RTOS_USE_COROUTINES
+    bad_sem_t *waitset = sem->waitset.signal;
+    if(waitset){
+        sem_put(waitset);
+    }
+#endif
     return BAD_RTOS_STATUS_OK;
 }
 
@@ -2979,6 +6263,12 @@ BAD_RTOS_STATIC bad_rtos_status_t __sem_put(bad_sem_t *sem){
         counter = __ldrex(&sem->counter);
     }while(__strex(counter+1, &sem->counter));
     
+#ifdef BAD_RTOS_USE_COROUTINES
+    bad_sem_t *waitset = sem->waitset.signal;
+    if(waitset){
+        __sem_put(waitset);
+    }
+#endif
     return BAD_RTOS_STATUS_OK;
 }
 
@@ -3008,24 +6298,94 @@ bad_rtos_status_t sem_put_from_isr(bad_sem_t *sem){
     uint32_t counter;
     do{
         counter = __ldrex(&sem->counter);
-        if(!counter){
-            __clrex();
-            return __kernel_notify(BAD_ISR_OP_SEM_PUT,sem);
-        }
-        
     }while(__strex(counter+1, &sem->counter));
     
+    // tasks only block on an empty semaphore, pendsv hands the counter to them 
+    // so a burst of puts is already summed up when it runs
+    if(!counter){
+        __kernel_notify(&sem->isr_node,BAD_ISR_OP_SEM_PUT,sem,1);
+    }
+#ifdef BAD_RTOS_USE_COROUTINES
+    bad_sem_t *waitset = sem->waitset.signal;
+    if(waitset){
+        sem_put_from_isr(waitset);
+    }
+#endif
     return BAD_RTOS_STATUS_OK;
 }
 
+// Pendsv side of sem_put_from_isr, the isr already counted the put
+BAD_RTOS_STATIC void __sem_isr_wake(bad_sem_t *sem){
+    uint32_t counter;
+    while(sem->blockedq.next){
+        do{
+            counter = __ldrex(&sem->counter);
+            if(!counter){
+                __clrex();
+                return;
+            }
+        }while(__strex(counter-1, &sem->counter));
+        __synchro_wake(&sem->blockedq,__sem_timeout_cb,BAD_RTOS_STATUS_OK);
+    }
+}
+
+#endif
+
+#ifdef BAD_RTOS_USE_POOL_WAIT
+BAD_RTOS_STATIC void __pool_timeout_cb(bad_task_handle_t handle ,void *blockedq){
+    bad_tcb_t *tcb = __tcb_slab_get_ptr_from_idx(BAD_TASK_HANDLE_GET_IDX(handle));
+    __prio_list_remove(blockedq,tcb,BAD_RTOS_MISC_POOL_BLOCKEDQ_MEMBER);
+    *(tcb->sp+9)=0; //no block
+}
+
+// Wakes the first waiter with the block as its return value
+BAD_RTOS_STATIC bad_tcb_t *__pool_hand_over(bad_pool_t *pool,void *block){
+    bad_tcb_t *tcb = __synchro_wake(&pool->blockedq,__pool_timeout_cb,BAD_RTOS_STATUS_OK);
+    if(!tcb){
+        return 0;
+    }
+    *(tcb->sp+9) = (uint32_t)block;
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    __pool_count_alloc(pool);
+#endif
+    return tcb;
+}
+
+BAD_RTOS_STATIC void* __pool_alloc_wait(bad_pool_t *pool,uint32_t delay){
+    void *block = __pool_take(pool);
+    if(block){
+        return block; //freed while entering the kernel
+    }
+#ifdef BAD_RTOS_USE_HEAP_STATS
+    __pool_count(&pool->fails, 1);
+#endif
+    __synchro_block(&pool->blockedq, __pool_timeout_cb, delay, BAD_RTOS_MISC_POOL_BLOCKEDQ_MEMBER);
+    return 0; //overwritten by the hand over
+}
+
+BAD_RTOS_STATIC void __pool_free(bad_pool_t *pool,void *obj){
+    if(!__pool_hand_over(pool,obj)){
+        __obj_list_push_atomic(pool,obj); //the waiters timed out in the meantime
+    }
+}
+
+// Pendsv side of pool_free from isrs, the blocks are already on the free list
+BAD_RTOS_STATIC void __pool_isr_wake(bad_pool_t *pool){
+    while(pool->blockedq.next){
+        void *block = __obj_list_pull_atomic(&pool->next);
+        if(!block){
+            return;
+        }
+        __pool_hand_over(pool,block);
+    }
+}
 #endif
 
 #ifdef BAD_RTOS_USE_EVENT_BARRIER
 
 static void __event_barrier_timeout_cb(bad_task_handle_t handle ,void *event_barrier){
-    (void)event_barrier;
     bad_tcb_t *tcb = __tcb_slab_get_ptr_from_idx(BAD_TASK_HANDLE_GET_IDX(handle));
-    __remove_entry(tcb,BAD_RTOS_MISC_EVENT_BARRIER_BLOCKEDQ_MEMBER);
+    __prio_list_remove(event_barrier,tcb,BAD_RTOS_MISC_EVENT_BARRIER_BLOCKEDQ_MEMBER);
     *(tcb->sp+9)=BAD_RTOS_STATUS_TIMEOUT;
 }
 
@@ -3033,10 +6393,14 @@ bad_rtos_status_t event_barrier_prime(bad_event_barrier_t *event_barrier, uint32
     if(!event_barrier|| !count || count >= 32){
         return BAD_RTOS_STATUS_BAD_PARAMETERS;
     }
-    if(event_barrier->count && event_barrier->count != 32){
-        return BAD_RTOS_STATUS_IN_USE;
+    if((event_barrier->count && event_barrier->count != 32) || event_barrier->isr_node.pending){
+        return BAD_RTOS_STATUS_IN_USE; //an isr fire still waits for pendsv
     }
-    *event_barrier = (bad_event_barrier_t){0};
+    event_barrier->blockedq = (bad_link_node_t){0};
+#ifdef BAD_RTOS_USE_WAITQ_INDEX
+    event_barrier->waitq_index.bmask = 0;
+#endif
+    event_barrier->flags = 0;
     BAD_OPT_BARRIER;
     event_barrier->count = count;
     return BAD_RTOS_STATUS_OK;
@@ -3088,64 +6452,406 @@ bad_rtos_status_t event_barrier_fire_from_isr(bad_event_barrier_t *event_barrier
         event_barrier->count = 32;
         BAD_OPT_BARRIER;
         event_barrier->flags = new_flags;//report correct flags on wakeup
-        return __kernel_notify(BAD_ISR_OP_EVENT_BARRIER_WAKE,event_barrier);
+        __kernel_notify(&event_barrier->isr_node,BAD_ISR_OP_EVENT_BARRIER_WAKE,event_barrier,1);
+    }
+    return BAD_RTOS_STATUS_OK;
+}
+
+BAD_RTOS_STATIC void __event_barrier_wake(bad_event_barrier_t *event_barrier){
+    uint32_t flags = event_barrier->flags;
+    __synchro_wake_all(&event_barrier->blockedq,__event_barrier_timeout_cb,flags|EVENT_BARRIER_FLAGS_VALID_MASK);
+}
+
+BAD_RTOS_STATIC bad_rtos_status_t __event_barrier_fire(bad_event_barrier_t *event_barrier,uint32_t flag){
+    if(!event_barrier ||!flag ||flag == EVENT_BARRIER_FLAGS_VALID_MASK){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    if(!event_barrier->count){
+        return BAD_RTOS_STATUS_NOT_INITIALISED; 
+    }    
+    
+    uint32_t flags,new_flags;
+    do{
+        
+        flags = __ldrex(&event_barrier->flags);
+        if(event_barrier->count == 32){
+            __clrex();
+            return BAD_RTOS_STATUS_FIRED;
+        }       
+        new_flags = flags | flag;
+        if(new_flags == flags){
+            __clrex();
+            return BAD_RTOS_STATUS_OK;
+        }    
+    }while(__strex(new_flags, &event_barrier->flags));
+    
+    if(__builtin_popcount(new_flags) == event_barrier->count){
+        event_barrier->count = 32; 
+        BAD_OPT_BARRIER;
+        event_barrier->flags = new_flags;//report correct flags on wakeup
+        __event_barrier_wake(event_barrier);
+    }
+    return BAD_RTOS_STATUS_OK;
+}
+
+BAD_RTOS_STATIC bad_rtos_status_t __event_barrier_delete(bad_event_barrier_t *event_barrier){
+    if(!event_barrier){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    if(!event_barrier->count){
+        return BAD_RTOS_STATUS_NOT_INITIALISED;
+    }
+    
+    __synchro_wake_all(&event_barrier->blockedq,__event_barrier_timeout_cb,BAD_RTOS_STATUS_DELETED);
+    
+    event_barrier->flags = 0; // isr_node may still sit in the isr queue, leave it linked
+    event_barrier->count = 0;
+    
+    return BAD_RTOS_STATUS_OK;
+}
+
+#endif
+
+#if defined(BAD_RTOS_USE_WORKQ) || defined(BAD_RTOS_USE_BASIC_TASKS)
+// Links an item on a run queue and posts its permit, refused while the item is still queued
+BAD_RTOS_STATIC bad_rtos_status_t __run_q_push(bad_run_q_t *rq, bad_run_item_t *item){
+    uint16_t pending;
+    do{
+        pending = __ldrexh(&item->node.pending);
+        if(pending){
+            __clrex();
+            return BAD_RTOS_STATUS_IN_USE; //already queued, runs once
+        }
+    }while(__strexh(1, &item->node.pending));
+    
+    __isr_q_push(&rq->q,&item->node);
+    if(__get_ipsr()){
+        return sem_put_from_isr(&rq->sem);
+    }
+    return sem_put(&rq->sem);
+}
+
+// Single consumer pop, basic task runners call it in thread mode, work workers through svc 0x1D
+BAD_RTOS_STATIC bad_run_item_t *__run_q_pop(bad_run_q_t *rq){
+    bad_isr_node_t *node = __isr_q_pop(&rq->q);
+    if(!node){
+        return 0;
+    }
+    return BAD_CONTAINER_OF(node, bad_run_item_t, node);
+}
+
+// Runner loop of the work workers and the basic task runners, a permit runs everything queued with
+// plain calls and the permits of items already run here are taken later without an svc
+// running holds the runner tcb while an item runs if the caller wants to know
+BAD_RTOS_STATIC void __run_q_serve(bad_run_q_t *rq, bad_run_pop_t pop, bad_tcb_t * volatile *running){
+    while(1){
+        if(sem_take(&rq->sem, 0) != BAD_RTOS_STATUS_OK){
+            continue;
+        }
+        bad_run_item_t *item;
+        while((item = pop(rq))){
+            bad_run_fn_t fn = item->fn;
+            void *arg = item->node.arg;
+            BAD_OPT_BARRIER;
+            item->node.pending = 0; //the item may be queued again while fn runs
+            if(running){
+                *running = shared_curr;
+            }
+            fn(arg);
+            if(running){
+                *running = 0;
+            }
+        }
+    }
+}
+#endif
+
+#ifdef BAD_RTOS_USE_WORKQ
+bad_rtos_status_t work_submit_from_isr(bad_work_t *work){
+    if(!__get_ipsr()){
+        return BAD_RTOS_STATUS_WRONG_CONTEXT;
+    }
+    
+    if(!work || !work->fn){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    
+    return __run_q_push(&kernel_workq, work);
+}
+
+BAD_RTOS_STATIC bad_work_t *__work_take(){
+    return __run_q_pop(&kernel_workq);
+}
+
+// Any number of workers share the queue, the pop goes through the kernel so they never race
+BAD_RTOS_STATIC bad_run_item_t *__work_pop(bad_run_q_t *rq){
+    (void)rq;
+    return __svc_work_take();
+}
+
+void work_worker(void *unused){
+    (void)unused;
+    __run_q_serve(&kernel_workq, __work_pop, 0);
+}
+#endif
+
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+bad_rtos_status_t basic_task_activate(bad_basic_task_t *task){
+    if(!task || !task->item.fn || task->level >= BAD_RTOS_BASIC_LEVELS){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    
+    return __run_q_push(&basic_levels[task->level].rq, &task->item);
+}
+
+void basic_runner(void *level){
+    if((uint32_t)level >= BAD_RTOS_BASIC_LEVELS){
+        task_finish(); //no such level, nothing would ever run here
+        return;
+    }
+    bad_basic_level_t *lvl = &basic_levels[(uint32_t)level];
+    __run_q_serve(&lvl->rq, __run_q_pop, &lvl->running);
+}
+#endif
+
+#ifdef BAD_RTOS_USE_COROUTINES
+bad_rtos_status_t coro_sched_init(bad_coro_sched_t *sched){
+    if(!sched){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    sched->head = 0;
+    return sem_init(&sched->signal, 0);
+}
+
+bad_rtos_status_t coro_spawn(bad_coro_sched_t *sched, bad_coro_t *coro, bad_coro_fn_t fn, void *arg){
+    if(!sched || !coro || !fn){
+        return BAD_RTOS_STATUS_BAD_PARAMETERS;
+    }
+    coro->fn = fn;
+    coro->arg = arg;
+    coro->sched = sched;
+    coro->line = 0;
+    coro->wait = BAD_CORO_WAIT_FOREVER;
+    coro->bound = 0;
+    coro->next = sched->head;
+    sched->head = coro;
+    sem_put(&sched->signal); //the host may be about to block
+    return BAD_RTOS_STATUS_OK;
+}
+
+void coro_wait_start(bad_coro_t *coro, uint32_t delay){
+    if(!delay){
+        coro->wait = BAD_CORO_WAIT_FOREVER;
+    }else if(delay == UINT32_MAX){
+        coro->wait = BAD_CORO_WAIT_NONE;
+    }else{
+        coro->wait = BAD_CORO_WAIT_TIMED;
+        coro->deadline = (uint32_t)kernel_ticks64() + delay;
+    }
+}
+
+void coro_sleep_start(bad_coro_t *coro, uint32_t ticks){
+    coro->wait = BAD_CORO_WAIT_TIMED;
+    coro->deadline = (uint32_t)kernel_ticks64() + ticks;
+}
+
+uint32_t coro_expired(bad_coro_t *coro){
+    return coro->wait == BAD_CORO_WAIT_TIMED && (int32_t)((uint32_t)kernel_ticks64() - coro->deadline) >= 0;
+}
+
+// Binds an awaited object to the wait set of the scheduler once per await, 0 if another scheduler holds it
+BAD_RTOS_STATIC uint32_t __coro_bind(bad_coro_t *coro, bad_coro_bind_t *bind){
+    if(coro->bound == bind){
+        return 1;
+    }
+    bad_sem_t *signal = &coro->sched->signal;
+    bad_sem_t *holder;
+    do{ // another host binding the same object at the same time must not share the count
+        holder = (bad_sem_t *)__ldrex((volatile uint32_t *)&bind->signal);
+        if(holder){
+            __clrex();
+            if(holder != signal){
+                return 0;
+            }
+            break;
+        }
+    }while(__strex((uint32_t)signal, (volatile uint32_t *)&bind->signal));
+    bind->count++;
+    coro->bound = bind;
+    return 1;
+}
+
+// The last coroutine leaving an await on the object drops the binding, puts stop signalling the scheduler
+void coro_unbind(bad_coro_t *coro){
+    bad_coro_bind_t *bind = coro->bound;
+    if(!bind){
+        return;
+    }
+    coro->bound = 0;
+    if(!--bind->count){
+        bind->signal = 0; //count is back to 0 before another host can claim it
+    }
+}
+
+// Returns 1 once the await is over, the object is bound to the wait set before it is checked
+// so a post between the check and the host blocking still wakes the host
+uint32_t coro_sem_poll(bad_coro_t *coro, bad_sem_t *sem, bad_rtos_status_t *status){
+    if(!sem){
+        *status = BAD_RTOS_STATUS_BAD_PARAMETERS;
+        return 1;
+    }
+    if(coro->wait != BAD_CORO_WAIT_NONE && !__coro_bind(coro, &sem->waitset)){
+        *status = BAD_RTOS_STATUS_IN_USE;
+        return 1;
+    }
+    bad_rtos_status_t ret = sem_take(sem, UINT32_MAX);
+    if(ret == BAD_RTOS_STATUS_WOULD_BLOCK && coro->wait != BAD_CORO_WAIT_NONE){
+        if(!coro_expired(coro)){
+            return 0;
+        }
+        ret = BAD_RTOS_STATUS_TIMEOUT;
+    }
+    coro_unbind(coro);
+    *status = ret;
+    return 1;
+}
+
+#ifdef BAD_RTOS_USE_MSGQ
+uint32_t coro_msgq_poll(bad_coro_t *coro, bad_msgq_t *q, bad_msg_block_t *writeback, bad_rtos_status_t *status){
+    if(!q){
+        *status = BAD_RTOS_STATUS_BAD_PARAMETERS;
+        return 1;
+    }
+    if(coro->wait != BAD_CORO_WAIT_NONE && !__coro_bind(coro, &q->waitset)){
+        *status = BAD_RTOS_STATUS_IN_USE;
+        return 1;
+    }
+    bad_rtos_status_t ret = msgq_pull_msg(q, writeback, UINT32_MAX);
+    if(ret == BAD_RTOS_STATUS_WOULD_BLOCK && coro->wait != BAD_CORO_WAIT_NONE){
+        if(!coro_expired(coro)){
+            return 0;
+        }
+        ret = BAD_RTOS_STATUS_TIMEOUT;
+    }
+    coro_unbind(coro);
+    *status = ret;
+    return 1;
+}
+#endif
+
+void coro_sched_run(bad_coro_sched_t *sched){
+    while(sched->head){
+        // posts up to here are seen by this pass, later ones leave a permit for the blocking take
+        while(sem_take(&sched->signal, UINT32_MAX) == BAD_RTOS_STATUS_OK){
+            
+        }
+        uint32_t runnable = 0;
+        bad_coro_t **link = &sched->head;
+        while(*link){
+            bad_coro_t *coro = *link;
+            bad_coro_state_t state = coro->fn(coro);
+            if(state == BAD_CORO_DONE){
+                *link = coro->next;
+                coro->next = 0;
+                continue;
+            }
+            if(state == BAD_CORO_YIELDED){
+                runnable = 1;
+            }
+            link = &coro->next;
+        }
+        if(runnable || !sched->head){
+            continue;
+        }
+        
+        uint32_t now = (uint32_t)kernel_ticks64();
+        uint32_t delay = 0; //forever unless someone has a deadline
+        for(bad_coro_t *coro = sched->head; coro; coro = coro->next){
+            if(coro->wait != BAD_CORO_WAIT_TIMED){
+                continue;
+            }
+            int32_t left = (int32_t)(coro->deadline - now);
+            if(left <= 0){
+                delay = UINT32_MAX;
+                break;
+            }
+            if(!delay || (uint32_t)left < delay){
+                delay = left;
+            }
+        }
+        if(delay != UINT32_MAX){
+            sem_take(&sched->signal, delay);
+        }
     }
-    return BAD_RTOS_STATUS_OK;
 }
+#endif
 
-BAD_RTOS_STATIC void __event_barrier_wake(bad_event_barrier_t *event_barrier){
-    uint32_t flags = event_barrier->flags;
-    __synchro_wake_all(&event_barrier->blockedq,__event_barrier_timeout_cb,flags|EVENT_BARRIER_FLAGS_VALID_MASK);
+#ifdef BAD_RTOS_USE_THREADED_IRQ
+void irq_thread_isr(void){
+    uint32_t irqn = __get_ipsr() - 16;
+    __nvic_disable_irq(irqn); //stays masked until the handler task waits again
+    bad_task_handle_t handle = irq_threads[irqn];
+    if(handle){
+        task_unblock_from_isr(handle);
+    }
 }
 
-BAD_RTOS_STATIC bad_rtos_status_t __event_barrier_fire(bad_event_barrier_t *event_barrier,uint32_t flag){
-    if(!event_barrier ||!flag ||flag == EVENT_BARRIER_FLAGS_VALID_MASK){
+BAD_RTOS_STATIC bad_rtos_status_t __irq_thread_register(uint32_t irqn, bad_task_handle_t handle){
+    if(irqn >= BAD_RTOS_IRQ_COUNT){
         return BAD_RTOS_STATUS_BAD_PARAMETERS;
     }
-    if(!event_barrier->count){
-        return BAD_RTOS_STATUS_NOT_INITIALISED; 
-    }    
     
-    uint32_t flags,new_flags;
-    do{
-        
-        flags = __ldrex(&event_barrier->flags);
-        if(event_barrier->count == 32){
-            __clrex();
-            return BAD_RTOS_STATUS_FIRED;
-        }       
-        new_flags = flags | flag;
-        if(new_flags == flags){
-            __clrex();
-            return BAD_RTOS_STATUS_OK;
-        }    
-    }while(__strex(new_flags, &event_barrier->flags));
+    bad_tcb_t *tcb = __tcb_slab_get_ptr_from_idx(BAD_TASK_HANDLE_GET_IDX(handle));
+    if(!handle || !tcb || tcb->generation != BAD_TASK_HANDLE_GET_GEN(handle)){
+        return BAD_RTOS_STATUS_HANDLE_INVALID;
+    }
     
-    if(__builtin_popcount(new_flags) == event_barrier->count){
-        event_barrier->count = 32; 
-        BAD_OPT_BARRIER;
-        event_barrier->flags = new_flags;//report correct flags on wakeup
-        __event_barrier_wake(event_barrier);
+    if(irq_threads[irqn] && irq_threads[irqn] != handle){
+        return BAD_RTOS_STATUS_ALREADY_BOUND;
     }
+    
+    __nvic_disable_irq(irqn);
+    irq_threads[irqn] = handle;
     return BAD_RTOS_STATUS_OK;
 }
 
-BAD_RTOS_STATIC bad_rtos_status_t __event_barrier_delete(bad_event_barrier_t *event_barrier){
-    if(!event_barrier){
+BAD_RTOS_STATIC bad_rtos_status_t __irq_thread_wait(uint32_t irqn){
+    if(irqn >= BAD_RTOS_IRQ_COUNT){
         return BAD_RTOS_STATUS_BAD_PARAMETERS;
     }
-    if(!event_barrier->count){
-        return BAD_RTOS_STATUS_NOT_INITIALISED;
-    }
-    
-    __synchro_wake_all(&event_barrier->blockedq,__event_barrier_timeout_cb,BAD_RTOS_STATUS_DELETED);
     
-    *event_barrier = (bad_event_barrier_t){0};
+    bad_tcb_t *curr = kernel_cb.curr;
+    bad_task_handle_t handle = __tcb_slab_get_idx_from_ptr(curr) | BAD_TASK_HANDLE_GEN(curr->generation);
+    if(irq_threads[irqn] != handle){
+        return BAD_RTOS_STATUS_NOT_OWNER;
+    }
     
+    __task_block();
+    // a line pending since the isr masked it fires as soon as the svc returns,
+    // its unblock is drained by pendsv after the task is already in the blocked list
+    __nvic_enable_irq(irqn);
     return BAD_RTOS_STATUS_OK;
 }
+#endif
 
+// Pendsv side of the tcb node, a handle gone stale while the node was queued drops the ops
+BAD_RTOS_STATIC void __task_isr_ops(bad_task_handle_t handle, uint32_t ops){
+    bad_tcb_t *tcb = __tcb_slab_get_ptr_from_idx(BAD_TASK_HANDLE_GET_IDX(handle));
+    if(!tcb || tcb->generation != BAD_TASK_HANDLE_GET_GEN(handle)){
+        return;
+    }
+#ifdef BAD_RTOS_USE_TASK_NOTIFY
+    if(ops & BAD_ISR_TASK_NOTIFY){ //first, a cancel in the same batch would wake it without the value
+        __task_notify_check(tcb);
+    }
 #endif
+    if(ops & BAD_ISR_TASK_UNBLOCK){
+        __task_unblock(handle);
+    }
+    if(ops & BAD_ISR_TASK_DELAY_CANCEL){
+        __task_delay_cancel(handle);
+    }
+}
 
 //ISRS
 
@@ -3171,15 +6877,57 @@ static void __attribute__((used)) __svc_c(uint8_t svc, uint32_t* stack){
             break;
         }
         case 0x6:{
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+            if(__basic_task_running()){
+                stack[0] = BAD_RTOS_STATUS_WRONG_CONTEXT;
+                break;
+            }
+#endif
             __task_block();            
             stack[0] = BAD_RTOS_STATUS_OK;              
             break;
         }
         case 0x7:{
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+            if(__basic_task_running()){
+                stack[0] = BAD_RTOS_STATUS_WRONG_CONTEXT;
+                break;
+            }
+#endif
             __task_delay(stack[0], (cbptr) stack[1] ,(void*)stack[2]);
             stack[0] = BAD_RTOS_STATUS_OK;
             break;
         }
+#ifdef BAD_RTOS_USE_TICKLESS_IDLE
+        case 0x8:{
+            __tickless_enter();
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_PERIODIC_TASKS
+        case 0x9:{
+            stack[0] = __task_delay_until((uint32_t *)stack[0], stack[1]);
+            break;
+        }
+        case 0x19:{
+            stack[0] = __task_wait_period();
+            break;
+        }
+        case 0x1A:{
+            stack[0] = __task_period_stats(stack[0], (bad_period_stats_t *)stack[1]);
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_TASK_NOTIFY
+        case 0x1B:{
+            stack[0] = __task_notify(stack[0], stack[1], (bad_notify_action_t)stack[2]);
+            break;
+        }
+        case 0x1C:{
+            stack[0] = __task_notify_wait(stack[0], stack[1], (uint32_t *)stack[2]);
+            break;
+        }
+#endif
         
 #ifdef BAD_RTOS_USE_SEMAPHORE
         case 0xA:{
@@ -3252,6 +7000,42 @@ static void __attribute__((used)) __svc_c(uint8_t svc, uint32_t* stack){
             stack[0] = __event_barrier_delete((bad_event_barrier_t *)stack[0]);
             break;
         }
+#endif
+#ifdef BAD_RTOS_USE_WORKQ
+        case 0x1D:{
+            stack[0] = (uint32_t)__work_take();
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_THREADED_IRQ
+        case 0x1E:{
+#ifdef BAD_RTOS_USE_BASIC_TASKS
+            if(__basic_task_running()){
+                stack[0] = BAD_RTOS_STATUS_WRONG_CONTEXT;
+                break;
+            }
+#endif
+            stack[0] = __irq_thread_wait(stack[0]);
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_KHEAP_LAZY_MERGE
+        case 0x1F:{
+            __buddy_merge(&kernel_buddy, BAD_RTOS_KHEAP_MERGE_BATCH);
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_POOL_WAIT
+        case 0x20:{
+            stack[0] = (uint32_t)__pool_alloc_wait((bad_pool_t *)stack[0], stack[1]);
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_STACK_WATERMARK
+        case 0x21:{
+            __stack_scan_batch();
+            break;
+        }
 #endif
         case 0xF0:{
             stack[0] = __sched_lock();
@@ -3271,6 +7055,46 @@ static void __attribute__((used)) __svc_c(uint8_t svc, uint32_t* stack){
             __kernel_free((void*)stack[0], stack[1]);
             break;
         } 
+#endif
+#ifdef BAD_RTOS_USE_KHEAP_ARENAS
+        case 0xF9:{
+            stack[0] = (uint32_t)__kernel_alloc_from(stack[0], stack[1]);
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_SLAB
+        case 0xFA:{
+            stack[0] = (uint32_t)__slab_refill(stack[0]);
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_KHEAP_MAGAZINES
+        case 0xFB:{
+            stack[0] = __kernel_alloc_batch(stack[0], (void **)stack[1], stack[2]);
+            break;
+        }
+        case 0xFC:{
+            __kernel_free_batch(stack[0], (void **)stack[1], stack[2]);
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_HEAP_STATS
+        case 0xFD:{
+            stack[0] = __kernel_mem_stats((bad_mem_stats_t *)stack[0]);
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_POOL_WAIT
+        case 0xFE:{
+            __pool_free((bad_pool_t *)stack[0], (void *)stack[1]);
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_STACK_WATERMARK
+        case 0xFF:{
+            stack[0] = __stack_stats(stack[0], (bad_stack_stats_t *)stack[1]);
+            break;
+        }
 #endif
         case 0xF4:{
             stack[0] = (uint32_t)__task_make((bad_task_descr_t*)stack[0]);
@@ -3280,6 +7104,26 @@ static void __attribute__((used)) __svc_c(uint8_t svc, uint32_t* stack){
             __kernel_start();
             break;
         }
+#ifdef BAD_RTOS_USE_MSGQ
+        case 0xF7:{
+            __msgq_commit((bad_msgq_t *)stack[0]);
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_SHARED_TIME
+        case 0xF6:{
+            uint64_t stamp = __kernel_timestamp();
+            stack[0] = (uint32_t)stamp;
+            stack[1] = (uint32_t)(stamp >> 32);
+            break;
+        }
+#endif
+#ifdef BAD_RTOS_USE_THREADED_IRQ
+        case 0xF8:{
+            stack[0] = __irq_thread_register(stack[0], stack[1]);
+            break;
+        }
+#endif
         default:{
             __builtin_unreachable();
         }
@@ -3287,35 +7131,53 @@ static void __attribute__((used)) __svc_c(uint8_t svc, uint32_t* stack){
 }
 
 static void __attribute__((used)) __pendsv_c(){
-    bad_isr_op_obj_t *msg;
+    bad_isr_node_t *msg;
+#ifdef BAD_RTOS_USE_TICKLESS_IDLE
+    if(kernel_cb.is_tickless){
+        uint32_t status = __tickless_exit();
+        if(status){
+            __handle_systick_event(status);
+        }
+    }
+#endif
+    // tasks woken by the drain only go to the readyq, the switch is decided once at the end
+    uint8_t unlocked = kernel_cb.is_unlocked;
+    kernel_cb.is_unlocked = 0;
     while((msg = __isr_q_pop(&kernel_cb.isrq))){
-        switch(msg->op_kind){
-            case BAD_ISR_OP_TASK_DELAY_CANCEL:{
-                __task_delay_cancel((bad_task_handle_t)(msg->arg));
-                break;
-            }
-            
-            case BAD_ISR_OP_TASK_UNBLOCK:{
-                __task_unblock((bad_task_handle_t)(msg->arg));
+        bad_isr_op_t op = msg->op_kind;
+        void *arg = msg->arg;
+        uint16_t ops;
+        do{ //popped, a signal from here on queues it again
+            ops = __ldrexh(&msg->pending);
+        }while(__strexh(0, &msg->pending));
+        switch(op){
+            case BAD_ISR_OP_TASK:{
+                __task_isr_ops((bad_task_handle_t)arg, ops);
                 break;
             }
             
 #ifdef BAD_RTOS_USE_SEMAPHORE
             case BAD_ISR_OP_SEM_PUT:{
-                __sem_put((bad_sem_t *)(msg->arg));
+                __sem_isr_wake((bad_sem_t *)arg);
                 break;
             }
 #endif
 #ifdef BAD_RTOS_USE_MSGQ
             case BAD_ISR_OP_MSGQ_WAKE:{
-                __msgq_try_wake((bad_msgq_t *)(msg->arg));
+                __msgq_try_wake((bad_msgq_t *)arg);
+                break;
+            }
+#endif
+#ifdef BAD_RTOS_USE_POOL_WAIT
+            case BAD_ISR_OP_POOL_WAKE:{
+                __pool_isr_wake((bad_pool_t *)arg);
                 break;
             }
 #endif
             
 #ifdef BAD_RTOS_USE_EVENT_BARRIER
             case BAD_ISR_OP_EVENT_BARRIER_WAKE:{
-                __event_barrier_wake((bad_event_barrier_t *)(msg->arg));
+                __event_barrier_wake((bad_event_barrier_t *)arg);
                 break;
             }
 #endif
@@ -3323,8 +7185,9 @@ static void __attribute__((used)) __pendsv_c(){
                 __builtin_unreachable();
             }
         }
-        gpool_free(msg);
     }
+    kernel_cb.is_unlocked = unlocked;
+    __sched_try_update();
 }
 
 // ASM stuff
@@ -3446,10 +7309,31 @@ void __attribute__((naked)) BAD_RTOS_TICK_HANDLER_NAME(){
                      ".cfi_adjust_cfa_offset 8 \n" 
                      ".cfi_rel_offset r3, 0    \n"
                      ".cfi_rel_offset r12, 4   \n"
+#endif
+#ifdef BAD_RTOS_USE_TICKLESS_IDLE
+                     "ldrb r0,[r2,#22]         \n"
+                     "cbz r0,.L_periodic_tick  \n"
+                     "bl __handle_tickless_systick_event\n"
+                     "b .L_event_handled       \n"
+                     ".L_periodic_tick:        \n"
 #endif
                      "ldr r1,[r2]              \n"
                      "adds r1,#1               \n"
                      "str r1,[r2]              \n"
+#ifdef BAD_RTOS_USE_SHARED_TIME
+                     "ldr r3,=%[time]          \n"
+                     "cbnz r1,.L_ticks_no_wrap \n"
+                     "ldr r0,[r3,#4]           \n"
+                     "adds r0,#1               \n"
+                     "cpsid i                  \n"
+                     "str r1,[r3]              \n"
+                     "str r0,[r3,#4]           \n"
+                     "cpsie i                  \n"
+                     "b .L_ticks_published     \n"
+                     ".L_ticks_no_wrap:        \n"
+                     "str r1,[r3]              \n"
+                     ".L_ticks_published:      \n"
+#endif
                      "ldr r1,[r2,#4]           \n"
                      "ldr r0,[r1,#44]          \n"
                      "subs r0,#1               \n"
@@ -3457,6 +7341,15 @@ void __attribute__((naked)) BAD_RTOS_TICK_HANDLER_NAME(){
                      "ite eq                   \n"
                      "moveq r0,#1              \n"
                      "movne r0,#0              \n"
+#ifdef BAD_RTOS_USE_TIMING_WHEEL
+                     "ldr r1,[r2]              \n"
+                     "ldr r2,[r2,#12]          \n"
+                     "and r1,r1,#31            \n"
+                     "lsr r2,r2,r1             \n"
+                     "tst r2,#1                \n"
+                     "it ne                    \n"
+                     "orrne r0,#2              \n"
+#else
                      "ldr r2,[r2,#16]          \n"
                      "cbnz r2,.L_nz_delayq     \n"
                      "b .L_skip_delayq         \n"
@@ -3467,6 +7360,7 @@ void __attribute__((naked)) BAD_RTOS_TICK_HANDLER_NAME(){
                      "it eq                    \n"
                      "orreq r0,#2              \n"
                      ".L_skip_delayq:          \n"
+#endif
                      "cbnz r0,.L_handle_event  \n"
                      ".cfi_remember_state      \n"
 #ifdef BAD_RTOS_USE_MPU
@@ -3485,7 +7379,7 @@ void __attribute__((naked)) BAD_RTOS_TICK_HANDLER_NAME(){
                      ".L_handle_event:         \n"
                      ".cfi_restore_state       \n"
                      "bl __handle_systick_event\n"
-                     
+                     ".L_event_handled:        \n"
                      "pop {r3,r12}             \n"
                      ".cfi_adjust_cfa_offset -8\n"
                      ".cfi_restore r3          \n"
@@ -3502,6 +7396,9 @@ void __attribute__((naked)) BAD_RTOS_TICK_HANDLER_NAME(){
                      : "i" (&kernel_cb)
 #ifdef BAD_RTOS_USE_MPU
                      ,"i" (&BAD_MPU->RNR)
+#endif
+#ifdef BAD_RTOS_USE_SHARED_TIME
+                     ,[time] "i" (&shared_time)
 #endif
                      :
                      );
@@ -3530,19 +7427,26 @@ static void __attribute__((naked,used)) __try_context_switch(){
                      "str r0,[r4]              \n"
                      "ldr r0,[r2]              \n"
                      "str r2,[r1,#4]           \n"
+                     "ldr r4,=shared_curr      \n"
+                     "str r2,[r4]              \n"
                      "movs r4,#0               \n"
                      "str r4,[r1,#8]           \n"
 #ifdef BAD_RTOS_USE_MPU
+                     "ldr r4,[r2,#4]           \n"
+                     "msr psplim,r4            \n"
+                     "ldr r2,[r2,#48]          \n"
+                     "ldr r4,[r1,#28]          \n"
+                     "cmp r2,r4                \n"
+                     "beq .L_regions_loaded    \n"
+                     "str r2,[r1,#28]          \n"
                      "mov r1,#0                \n"
                      "str r1,[r12]             \n"
-                     "ldr r1,[r2,#4]           \n"
-                     "msr psplim,r1            \n"
-                     "ldr r2,[r2,#48]          \n"
                      "add r1,r12,#4            \n"
                      "ldmia r2!,{r4-r11}       \n"
                      "stmia r1!,{r4-r11}       \n"
                      "mov r2,#7                \n"
                      "str r2,[r12]             \n"
+                     ".L_regions_loaded:       \n"
                      "str r3,[r12,#8]          \n"
                      "dsb                      \n"
                      "isb                      \n"
@@ -3605,6 +7509,15 @@ __asm__(
         ".global idle_task              \n"
         "idle_task:                     \n"
         "infinite_loop:                 \n"
+#ifdef BAD_RTOS_USE_KHEAP_LAZY_MERGE
+        "svc 0x1F                       \n" //merge a batch of free buddies before sleeping
+#endif
+#ifdef BAD_RTOS_USE_STACK_WATERMARK
+        "svc 0x21                       \n" //check a batch of stack words
+#endif
+#ifdef BAD_RTOS_USE_TICKLESS_IDLE
+        "svc 0x8                        \n"
+#endif
         "dsb                            \n"
         "wfi                            \n"
         "b infinite_loop                \n"
@@ -3619,6 +7532,16 @@ __asm__(
         "bx lr                          \n"
         );
 
+#ifdef BAD_RTOS_USE_SHARED_TIME
+__asm__(
+        ".thumb_func                    \n"
+        ".global __kernel_timestamp_svc \n"
+        "__kernel_timestamp_svc:        \n"
+        "svc 0xF6                       \n"
+        "bx lr                          \n"
+        );
+#endif
+
 __asm__(
         ".thumb_func                    \n"
         ".global task_make              \n"
@@ -3676,24 +7599,154 @@ __asm__(
         "bx lr                          \n"
         );
 
+#ifdef BAD_RTOS_USE_PERIODIC_TASKS
+__asm__(
+        ".thumb_func                    \n"
+        ".global task_delay_until       \n"
+        "task_delay_until:              \n"
+        "svc 0x9                        \n"
+        "bx lr                          \n"
+        );
+
+__asm__(
+        ".thumb_func                    \n"
+        ".global task_wait_period       \n"
+        "task_wait_period:              \n"
+        "svc 0x19                       \n"
+        "bx lr                          \n"
+        );
+
+__asm__(
+        ".thumb_func                    \n"
+        ".global task_period_stats      \n"
+        "task_period_stats:             \n"
+        "svc 0x1A                       \n"
+        "bx lr                          \n"
+        );
+#endif
+
+#ifdef BAD_RTOS_USE_TASK_NOTIFY
+__asm__(
+        ".thumb_func                    \n"
+        ".global task_notify            \n"
+        "task_notify:                   \n"
+        "svc 0x1B                       \n"
+        "bx lr                          \n"
+        );
+
+__asm__(
+        ".thumb_func                    \n"
+        ".global task_notify_wait       \n"
+        "task_notify_wait:              \n"
+        "svc 0x1C                       \n"
+        "bx lr                          \n"
+        );
+#endif
+
 #ifdef BAD_RTOS_USE_KHEAP
 __asm__(
         ".thumb_func                    \n"
+#ifdef BAD_RTOS_USE_KHEAP_MAGAZINES
+        ".global __svc_kernel_alloc     \n"
+        "__svc_kernel_alloc:            \n"
+#else
         ".global kernel_alloc           \n"
         "kernel_alloc:                  \n"
+#endif
         "svc 0xF2                       \n"
         "bx lr                          \n"
         );
 
 __asm__(
         ".thumb_func                    \n"
+#ifdef BAD_RTOS_USE_KHEAP_MAGAZINES
+        ".global __svc_kernel_free      \n"
+        "__svc_kernel_free:             \n"
+#else
         ".global kernel_free            \n"
         "kernel_free:                   \n"
+#endif
         "svc 0xF3                       \n"
         "bx lr                          \n"
         );
 #endif
 
+#ifdef BAD_RTOS_USE_KHEAP_MAGAZINES
+__asm__(
+        ".thumb_func                    \n"
+        ".global __svc_kernel_alloc_batch\n"
+        "__svc_kernel_alloc_batch:      \n"
+        "svc 0xFB                       \n"
+        "bx lr                          \n"
+        );
+
+__asm__(
+        ".thumb_func                    \n"
+        ".global __svc_kernel_free_batch\n"
+        "__svc_kernel_free_batch:       \n"
+        "svc 0xFC                       \n"
+        "bx lr                          \n"
+        );
+#endif
+
+#ifdef BAD_RTOS_USE_KHEAP_ARENAS
+__asm__(
+        ".thumb_func                    \n"
+        ".global kernel_alloc_from      \n"
+        "kernel_alloc_from:             \n"
+        "svc 0xF9                       \n"
+        "bx lr                          \n"
+        );
+#endif
+
+#ifdef BAD_RTOS_USE_SLAB
+__asm__(
+        ".thumb_func                    \n"
+        ".global __svc_slab_refill      \n"
+        "__svc_slab_refill:             \n"
+        "svc 0xFA                       \n"
+        "bx lr                          \n"
+        );
+#endif
+
+#ifdef BAD_RTOS_USE_HEAP_STATS
+__asm__(
+        ".thumb_func                    \n"
+        ".global kernel_mem_stats       \n"
+        "kernel_mem_stats:              \n"
+        "svc 0xFD                       \n"
+        "bx lr                          \n"
+        );
+#endif
+
+#ifdef BAD_RTOS_USE_POOL_WAIT
+__asm__(
+        ".thumb_func                    \n"
+        ".global __svc_pool_alloc_wait  \n"
+        "__svc_pool_alloc_wait:         \n"
+        "svc 0x20                       \n"
+        "bx lr                          \n"
+        );
+
+__asm__(
+        ".thumb_func                    \n"
+        ".global __svc_pool_free        \n"
+        "__svc_pool_free:               \n"
+        "svc 0xFE                       \n"
+        "bx lr                          \n"
+        );
+#endif
+
+#ifdef BAD_RTOS_USE_STACK_WATERMARK
+__asm__(
+        ".thumb_func                    \n"
+        ".global __svc_stack_stats      \n"
+        "__svc_stack_stats:             \n"
+        "svc 0xFF                       \n"
+        "bx lr                          \n"
+        );
+#endif
+
 #ifdef BAD_RTOS_USE_SEMAPHORE
 __asm__(
         ".thumb_func                    \n"
@@ -3721,16 +7774,16 @@ __asm__(
 #ifdef BAD_RTOS_USE_MUTEX
 __asm__(
         ".thumb_func                    \n"
-        ".global mutex_put              \n"
-        "mutex_put:                     \n"
+        ".global __svc_mutex_put        \n"
+        "__svc_mutex_put:               \n"
         "svc 0xD                        \n"
         "bx lr                          \n"
         );
 
 __asm__(
         ".thumb_func                    \n"
-        ".global mutex_take             \n"
-        "mutex_take:                    \n"
+        ".global __svc_mutex_take       \n"
+        "__svc_mutex_take:              \n"
         "svc 0xE                        \n"
         "bx lr                          \n"
         );
@@ -3748,20 +7801,28 @@ __asm__(
 #ifdef BAD_RTOS_USE_MSGQ
 __asm__(
         ".thumb_func                    \n"
-        ".global msgq_post_msg          \n"
-        "msgq_post_msg:                 \n"
+        ".global __svc_msgq_post_msg    \n"
+        "__svc_msgq_post_msg:           \n"
         "svc 0x10                       \n"
         "bx lr                          \n"
         );
 
 __asm__(
         ".thumb_func                    \n"
-        ".global msgq_pull_msg          \n"
-        "msgq_pull_msg:                 \n"
+        ".global __svc_msgq_pull_msg    \n"
+        "__svc_msgq_pull_msg:           \n"
         "svc 0x11                       \n"
         "bx lr                          \n"
         );
 
+__asm__(
+        ".thumb_func                    \n"
+        ".global __svc_msgq_commit      \n"
+        "__svc_msgq_commit:             \n"
+        "svc 0xF7                       \n"
+        "bx lr                          \n"
+        );
+
 __asm__(
         ".thumb_func                    \n"
         ".global msgq_aqcuire           \n"
@@ -3824,6 +7885,34 @@ __asm__(
 
 #endif
 
+#ifdef BAD_RTOS_USE_WORKQ
+__asm__(
+        ".thumb_func                    \n"
+        ".global __svc_work_take        \n"
+        "__svc_work_take:               \n"
+        "svc 0x1D                       \n"
+        "bx lr                          \n"
+        );
+#endif
+
+#ifdef BAD_RTOS_USE_THREADED_IRQ
+__asm__(
+        ".thumb_func                    \n"
+        ".global irq_thread_register    \n"
+        "irq_thread_register:           \n"
+        "svc 0xF8                       \n"
+        "bx lr                          \n"
+        );
+
+__asm__(
+        ".thumb_func                    \n"
+        ".global irq_thread_wait        \n"
+        "irq_thread_wait:               \n"
+        "svc 0x1E                       \n"
+        "bx lr                          \n"
+        );
+#endif
+
 //helpers for specific common operations
 
 static inline __attribute__((always_inline)) uint32_t __ldrex(volatile uint32_t* addr){
@@ -0,0 +1,142 @@
+#define BAD_RTOS_USE_SEMAPHORE
+#define BAD_RTOS_USE_BASIC_TASKS
+#define BAD_RTOS_BASIC_LEVELS (2)
+#define BAD_RTOS_ISR_TEST
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// Three basic tasks share two runner stacks, the timer isr activates the level 1 handler which
+// chains the two level 0 handlers, the second activation of each of them is refused while it is queued
+// task1 spins below both levels and activates the slow handler from thread mode, the slow handler
+// tries to delay and gets refused
+
+bad_task_handle_t runner0h;
+bad_task_handle_t runner1h;
+bad_task_handle_t task1h;
+
+volatile uint32_t isr_runs;
+volatile uint32_t fast_runs;
+volatile uint32_t slow_runs;
+volatile uint32_t refused;
+volatile uint32_t refused_blocks;
+
+void fast_handler(void *arg){
+    (*(volatile uint32_t *)arg)++;
+}
+
+void slow_handler(void *arg){
+    (*(volatile uint32_t *)arg)++;
+    for(volatile uint32_t i = 0; i < 1000; i++){ //busy, never blocks
+        
+    }
+    if(task_delay(1, 0, 0) == BAD_RTOS_STATUS_WRONG_CONTEXT){ //blocking calls are refused
+        refused_blocks++;
+    }
+}
+
+BASIC_TASK_STATIC_INIT(fast_task, fast_handler, (void *)&fast_runs, 0)
+BASIC_TASK_STATIC_INIT(slow_task, slow_handler, (void *)&slow_runs, 0)
+
+void isr_handler(void *arg){
+    (*(volatile uint32_t *)arg)++;
+    basic_task_activate(&slow_task);
+    basic_task_activate(&fast_task);
+    if(basic_task_activate(&fast_task) == BAD_RTOS_STATUS_IN_USE){
+        refused++;
+    }
+}
+
+BASIC_TASK_STATIC_INIT(isr_task, isr_handler, (void *)&isr_runs, 1)
+
+void task1(void *unused){
+    (void)unused;
+    while (1) {
+        basic_task_activate(&slow_task);
+    }
+}
+
+void isr_test(){
+    basic_task_activate(&isr_task);
+}
+
+#define TASK1_PRIORITY 3
+#define RUNNER0_PRIORITY 2
+#define RUNNER1_PRIORITY 1
+#define RUNNER0_STACK_SIZE 512
+#define RUNNER1_STACK_SIZE 512
+#define TASK1_STACK_SIZE 512
+
+TASK_STATIC_STACK(runner0, RUNNER0_STACK_SIZE);
+TASK_STATIC_STACK(runner1, RUNNER1_STACK_SIZE);
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(runner0)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(runner0_stack,RUNNER0_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(runner0)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(runner1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(runner1_stack,RUNNER1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(runner1)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t runner0_descr = {
+        .stack = runner0_stack,
+        .stack_size = RUNNER0_STACK_SIZE,
+        .entry = basic_runner,
+        .args = (void *)0,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = runner0_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = RUNNER0_PRIORITY
+    };
+    runner0h = task_make(&runner0_descr);
+    bad_task_descr_t runner1_descr = {
+        .stack = runner1_stack,
+        .stack_size = RUNNER1_STACK_SIZE,
+        .entry = basic_runner,
+        .args = (void *)1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = runner1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = RUNNER1_PRIORITY
+    };
+    runner1h = task_make(&runner1_descr);
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+#define BAD_RTOS_USE_SHARED_TIME
+#define BAD_RTOS_USE_COROUTINES
+#define BAD_RTOS_ISR_TEST
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// One host task runs a message reader, CONN_COUNT connection handlers sharing the semaphore the timer
+// isr puts, and a short lived coroutine. task2 posts to the queue owned by the host with pauses longer
+// than the reader timeout, so both the post and the timeout path of the wait set get exercised
+
+#define CONN_COUNT 16
+
+typedef struct{
+    bad_coro_t coro;
+    bad_rtos_status_t status;
+    uint32_t runs;
+    uint32_t timeouts;
+    bad_msg_block_t msg;
+}conn_t;
+
+bad_task_handle_t hosth;
+bad_task_handle_t task2h;
+
+MSGQ_STATIC_INIT(hostq, 8);
+bad_sem_t isr_sem;
+bad_coro_sched_t sched;
+
+conn_t reader;
+conn_t conns[CONN_COUNT];
+conn_t oneshot;
+
+volatile uint32_t posted;
+volatile uint32_t oneshot_done;
+
+bad_coro_state_t reader_coro(bad_coro_t *coro){
+    conn_t *c = coro->arg;
+    CORO_BEGIN(coro);
+    while(1){
+        CORO_MSGQ_PULL(coro, &hostq, &c->msg, 10, c->status);
+        if(c->status == BAD_RTOS_STATUS_OK){
+            c->runs++;
+        }else if(c->status == BAD_RTOS_STATUS_TIMEOUT){
+            c->timeouts++;
+        }
+    }
+    CORO_END(coro);
+}
+
+bad_coro_state_t conn_coro(bad_coro_t *coro){
+    conn_t *c = coro->arg;
+    CORO_BEGIN(coro);
+    while(1){
+        CORO_SEM_TAKE(coro, &isr_sem, 0, c->status);
+        c->runs++;
+        CORO_DELAY(coro, 1 + (c - conns)); //handlers fall out of step with each other
+        CORO_YIELD(coro);
+    }
+    CORO_END(coro);
+}
+
+bad_coro_state_t oneshot_coro(bad_coro_t *coro){
+    conn_t *c = coro->arg;
+    CORO_BEGIN(coro);
+    for(c->runs = 0; c->runs < 3; c->runs++){
+        CORO_DELAY(coro, 5);
+    }
+    oneshot_done = 1;
+    CORO_END(coro);
+}
+
+void host(void *unused){
+    (void)unused;
+    coro_sched_init(&sched);
+    coro_spawn(&sched, &reader.coro, reader_coro, &reader);
+    for(uint32_t i = 0; i < CONN_COUNT; i++){
+        coro_spawn(&sched, &conns[i].coro, conn_coro, &conns[i]);
+    }
+    coro_spawn(&sched, &oneshot.coro, oneshot_coro, &oneshot);
+    coro_sched_run(&sched);
+    while(1){ //never reached, the handlers loop forever
+        
+    }
+}
+
+void task2(void *unused){
+    (void)unused;
+    uint32_t sig = 0;
+    while (1) {
+        for(uint32_t i = 0; i < 4; i++){
+            if(msgq_post_msg(&hostq, sig++, 0, 0) == BAD_RTOS_STATUS_OK){
+                posted++;
+            }
+        }
+        task_delay(25, 0, 0);
+    }
+}
+
+void isr_test(){
+    sem_put_from_isr(&isr_sem);
+}
+
+#define HOST_PRIORITY 1
+#define TASK2_PRIORITY 2
+#define HOST_STACK_SIZE 512
+#define TASK2_STACK_SIZE 512
+
+TASK_STATIC_STACK(host, HOST_STACK_SIZE);
+TASK_STATIC_STACK(task2, TASK2_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(host)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(host_stack,HOST_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(host)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task2)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task2_stack,TASK2_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task2)
+#endif
+
+void bad_user_init(){
+    sem_init(&isr_sem, 0);
+    bad_task_descr_t host_descr = {
+        .stack = host_stack,
+        .stack_size = HOST_STACK_SIZE,
+        .entry = host,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = host_regions,
+#endif
+        .ticks_to_change = 500,
+        .assigned_msgq = &hostq,
+        .base_priority = HOST_PRIORITY
+    };
+    hosth = task_make(&host_descr);
+    bad_task_descr_t task2_descr = {
+        .stack = task2_stack,
+        .stack_size = TASK2_STACK_SIZE,
+        .entry = task2,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task2_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK2_PRIORITY
+    };
+    task2h = task_make(&task2_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
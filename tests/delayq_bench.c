@@ -0,0 +1,77 @@
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// Delay queue cost with N sleepers, build with -DBAD_RTOS_USE_TIMING_WHEEL 
+// (delayq_bench_wheel target) to compare the wheel against the delta list.
+// Runs before the scheduler, results are read with the debugger
+
+#define BENCH_DEMCR (*(volatile uint32_t *)0xE000EDFC)
+#define BENCH_DEMCR_TRCENA (0x1 << 24)
+#define BENCH_DWT_CTRL (*(volatile uint32_t *)0xE0001000)
+#define BENCH_DWT_CTRL_CYCCNTENA (0x1 << 0)
+#define BENCH_DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+
+#define BENCH_MAX_SLEEPERS 31
+#define BENCH_RUNS 3
+
+static const uint32_t bench_sleepers[BENCH_RUNS] = {4, 16, 31};
+static bad_tcb_t bench_tcbs[BENCH_MAX_SLEEPERS + 1];
+
+volatile uint32_t bench_enqueue_cycles[BENCH_RUNS];
+volatile uint32_t bench_cancel_cycles[BENCH_RUNS];
+volatile uint32_t bench_done;
+
+static void bench_reset(){
+    for (uint32_t i = 0; i < BENCH_MAX_SLEEPERS + 1; i++) {
+        bench_tcbs[i] = (bad_tcb_t){0};
+        bench_tcbs[i].delayq_misc = BAD_RTOS_MISC_NOT_DELAYED;
+    }
+    kernel_cb.ticks = 0;
+#ifdef BAD_RTOS_USE_TIMING_WHEEL
+    kernel_cb.wheel_bmask = 0;
+    kernel_cb.wheel_last = 0;
+    __delayq_init();
+#else
+    kernel_cb.delayq = (bad_link_node_t){0};
+#endif
+}
+
+static void bench_run(uint32_t run){
+    uint32_t sleepers = bench_sleepers[run];
+    bench_reset();
+    for (uint32_t i = 0; i < sleepers; i++) {
+        __delayq_enqueue(&bench_tcbs[i], 100 + i * 7);
+    }
+    bad_tcb_t *probe = &bench_tcbs[BENCH_MAX_SLEEPERS];
+    
+    // Worst case for the delta list, probe lands behind every sleeper 
+    uint32_t start = BENCH_DWT_CYCCNT;
+    __delayq_enqueue(probe, 1000);
+    bench_enqueue_cycles[run] = BENCH_DWT_CYCCNT - start;
+    
+    start = BENCH_DWT_CYCCNT;
+    __delayq_dequeue(probe);
+    bench_cancel_cycles[run] = BENCH_DWT_CYCCNT - start;
+}
+
+void bad_user_init(){
+}
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __kernel_sections_init();
+    BENCH_DEMCR |= BENCH_DEMCR_TRCENA;
+    BENCH_DWT_CYCCNT = 0;
+    BENCH_DWT_CTRL |= BENCH_DWT_CTRL_CYCCNTENA;
+    
+    for (uint32_t run = 0; run < BENCH_RUNS; run++) {
+        bench_run(run);
+    }
+    bench_done = 1;
+    while(1){
+        
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#define BAD_RTOS_ISR_TEST
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// Every timer interrupt puts the semaphore far more times than the global pool has blocks
+// and unblocks task2, no put may be lost and no call may fail
+
+#define PUTS_PER_ISR (BAD_RTOS_GLOBAL_POOL_SIZE * 2)
+
+bad_task_handle_t task1h;
+bad_task_handle_t task2h;
+
+bad_sem_t sem = {.init_flag = 1};
+
+volatile uint32_t puts;
+volatile uint32_t takes;
+volatile uint32_t unblocks;
+volatile uint32_t isr_errors;
+
+void task1(void *unused){
+    (void)unused;
+    while (1) {
+        if(sem_take(&sem,0) == BAD_RTOS_STATUS_OK){
+            takes++;
+        }
+    }
+}
+
+void task2(void *unused){
+    (void)unused;
+    while (1) {
+        task_block();
+        unblocks++;
+    }
+}
+
+void isr_test(){
+    for(uint32_t i = 0; i < PUTS_PER_ISR; i++){
+        if(sem_put_from_isr(&sem) == BAD_RTOS_STATUS_OK){
+            puts++;
+        }else{
+            isr_errors++;
+        }
+    }
+    if(task_unblock_from_isr(task2h) != BAD_RTOS_STATUS_OK){
+        isr_errors++;
+    }
+}
+
+#define TASK1_PRIORITY 1 
+#define TASK2_PRIORITY 2
+#define TASK1_STACK_SIZE 1024
+#define TASK2_STACK_SIZE 1024
+
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+TASK_STATIC_STACK(task2, TASK2_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task2)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task2_stack,TASK2_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task2)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+    bad_task_descr_t task2_descr = {
+        .stack = task2_stack,
+        .stack_size = TASK2_STACK_SIZE,
+        .entry = task2,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task2_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK2_PRIORITY
+    };
+    task2h = task_make(&task2_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+#define BAD_RTOS_USE_KHEAP_TLSF
+#define BAD_RTOS_USE_KHEAP_ARENAS
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#define BAD_RTOS_IMPLEMENTATION
+#include "platform_include.h"
+
+// Every policy is checked against the address ranges of the arenas,
+// a block larger than kheap has to fall through the chain into the last arena (none on the f411)
+
+#define LAST_ARENA (BAD_RTOS_KHEAP_ARENA_COUNT - 1)
+
+bad_task_handle_t task1h;
+volatile uint32_t rounds;
+volatile uint32_t wrong_arena;
+volatile uint32_t alloc_fails;
+volatile uint32_t big_allocs;
+
+static uint32_t in_arena(void *block, uint32_t arena){
+    return (uint8_t *)block >= kheap_banks[arena].start && (uint8_t *)block < kheap_banks[arena].end;
+}
+
+void task1(void *unused){
+    (void)unused;
+    while (1) {
+        void *fast = kernel_alloc(100);
+        void *pinned = kernel_alloc_from(64, BAD_KHEAP_BANK(LAST_ARENA));
+        void *big = kernel_alloc_from(KHEAP_SIZE, BAD_KHEAP_CHAIN(0, LAST_ARENA));
+        
+        if(!fast || !pinned){
+            alloc_fails++;
+        }
+        if(fast && !in_arena(fast, 0)){
+            wrong_arena++;
+        }
+        if(pinned && !in_arena(pinned, LAST_ARENA)){
+            wrong_arena++;
+        }
+        if(big){
+            big_allocs++;
+            if(!in_arena(big, LAST_ARENA)){
+                wrong_arena++;
+            }
+            kernel_free(big, KHEAP_SIZE);
+        }
+        kernel_free(pinned, 64);
+        kernel_free(fast, 100);
+        rounds++;
+        task_delay(10, 0, 0);
+    }
+}
+
+#define TASK1_PRIORITY 1 
+#define TASK1_STACK_SIZE 1024
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
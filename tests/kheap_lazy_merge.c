@@ -0,0 +1,132 @@
+#define BAD_RTOS_USE_KHEAP_LAZY_MERGE
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// task1 shreds the heap into small blocks and frees them without merging,
+// then asks for a large block, idle merges in the background while task1 sleeps,
+// task2 allocs large blocks right after the frees so the merge on failure path runs too
+
+bad_task_handle_t task1h;
+bad_task_handle_t task2h;
+
+#define SMALL_SIZE 32
+#define SMALL_COUNT 32
+#define LARGE_SIZE 1024
+
+volatile uint32_t rounds;
+volatile uint32_t small_fails;
+volatile uint32_t large_fails;
+volatile uint32_t corruptions;
+volatile uint32_t task2_large;
+
+void task1(void *unused){
+    (void)unused;
+    uint8_t *blocks[SMALL_COUNT];
+    while (1) {
+        for(uint32_t i = 0; i < SMALL_COUNT; i++){
+            blocks[i] = kernel_alloc(SMALL_SIZE);
+            if(!blocks[i]){
+                small_fails++;
+                continue;
+            }
+            for(uint32_t j = 0; j < SMALL_SIZE; j++){
+                blocks[i][j] = (uint8_t)(rounds + i);
+            }
+        }
+        for(uint32_t i = 0; i < SMALL_COUNT; i++){
+            if(!blocks[i]){
+                continue;
+            }
+            for(uint32_t j = 0; j < SMALL_SIZE; j++){
+                if(blocks[i][j] != (uint8_t)(rounds + i)){
+                    corruptions++;
+                    break;
+                }
+            }
+            kernel_free(blocks[i], SMALL_SIZE);
+        }
+        if(rounds & 1){
+            task_delay(3, 0, 0); //give idle time to merge
+        }
+        uint8_t *large = kernel_alloc(LARGE_SIZE);
+        if(!large){
+            large_fails++;
+        }else{
+            kernel_free(large, LARGE_SIZE);
+        }
+        rounds++;
+        task_delay(1, 0, 0);
+    }
+}
+
+void task2(void *unused){
+    (void)unused;
+    while (1) {
+        uint8_t *large = kernel_alloc(LARGE_SIZE);
+        if(large){
+            task2_large++;
+            kernel_free(large, LARGE_SIZE);
+        }
+        task_delay(2, 0, 0);
+    }
+}
+
+#define TASK1_PRIORITY 1
+#define TASK2_PRIORITY 2
+#define TASK1_STACK_SIZE 512
+#define TASK2_STACK_SIZE 512
+
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+TASK_STATIC_STACK(task2, TASK2_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task2)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task2_stack,TASK2_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task2)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+    bad_task_descr_t task2_descr = {
+        .stack = task2_stack,
+        .stack_size = TASK2_STACK_SIZE,
+        .entry = task2,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task2_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK2_PRIORITY
+    };
+    task2h = task_make(&task2_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
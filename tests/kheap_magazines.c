@@ -0,0 +1,127 @@
+#define BAD_RTOS_USE_KHEAP_MAGAZINES
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// task1 churns small blocks through its magazine and a large one through the svc,
+// task2 frees blocks it got from task1 into its own magazine and finishes, flushing it to the heap
+
+bad_task_handle_t task1h;
+bad_task_handle_t task2h;
+
+volatile uint32_t rounds;
+volatile uint32_t alloc_fails;
+volatile uint32_t corruptions;
+volatile uint32_t handed_over;
+
+static const uint32_t sizes[] = {16, 50, 100, 300};
+void * volatile handover[2];
+
+void task1(void *unused){
+    (void)unused;
+    uint8_t *blocks[sizeof(sizes)/sizeof(sizes[0])];
+    while (1) {
+        for(uint32_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++){
+            blocks[i] = kernel_alloc(sizes[i]);
+            if(!blocks[i]){
+                alloc_fails++;
+                continue;
+            }
+            for(uint32_t j = 0; j < sizes[i]; j++){
+                blocks[i][j] = (uint8_t)(rounds + i);
+            }
+        }
+        task_delay(1, 0, 0);
+        for(uint32_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++){
+            if(!blocks[i]){
+                continue;
+            }
+            for(uint32_t j = 0; j < sizes[i]; j++){
+                if(blocks[i][j] != (uint8_t)(rounds + i)){
+                    corruptions++;
+                    break;
+                }
+            }
+            kernel_free(blocks[i], sizes[i]);
+        }
+        if(!handover[0] && !handover[1] && rounds < 8){
+            handover[0] = kernel_alloc(16);
+            handover[1] = kernel_alloc(100);
+        }
+        rounds++;
+    }
+}
+
+void task2(void *unused){
+    (void)unused;
+    while (handed_over < 8) {
+        if(handover[0] && handover[1]){
+            kernel_free(handover[0], 16);
+            kernel_free(handover[1], 100);
+            handover[0] = 0;
+            handover[1] = 0;
+            handed_over++;
+        }
+        task_delay(2, 0, 0);
+    }
+    task_finish();
+}
+
+#define TASK1_PRIORITY 1
+#define TASK2_PRIORITY 2
+#define TASK1_STACK_SIZE 512
+#define TASK2_STACK_SIZE 512
+
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+TASK_STATIC_STACK(task2, TASK2_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task2)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task2_stack,TASK2_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task2)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+    bad_task_descr_t task2_descr = {
+        .stack = task2_stack,
+        .stack_size = TASK2_STACK_SIZE,
+        .entry = task2,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task2_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK2_PRIORITY
+    };
+    task2h = task_make(&task2_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
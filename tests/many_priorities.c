@@ -0,0 +1,76 @@
+#define BAD_RTOS_MAX_TASKS (40)
+#define BAD_RTOS_PRIO_COUNT (64)
+#define KMAX_ORDER 14
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// 34 workers on priorities 29 to 62 plus the checker and idle, more than 32 tasks over more than 32
+// priorities so both two level bitmaps are used. Workers are made in a shuffled order, each one logs
+// its priority and blocks, so they have to run highest priority first across the summary word boundary
+// The checker wakes above all of them and verifies the log
+
+#define WORKER_COUNT 34
+#define WORKER_FIRST_PRIORITY (BAD_RTOS_PRIO_COUNT - 1 - WORKER_COUNT)
+#define WORKER_STACK_SIZE 256
+#define CHECKER_PRIORITY 0
+#define CHECKER_STACK_SIZE 512
+
+volatile uint32_t run_pos;
+volatile uint32_t run_order[WORKER_COUNT];
+volatile uint32_t order_ok;
+
+void worker(void *prio){
+    run_order[run_pos++] = (uint32_t)prio;
+    while (1) {
+        task_delay(1000, 0, 0);
+    }
+}
+
+void checker(void *unused){
+    (void)unused;
+    task_delay(10, 0, 0);
+    uint32_t ok = run_pos == WORKER_COUNT;
+    for (uint32_t i = 0; i < WORKER_COUNT; i++) {
+        ok &= run_order[i] == WORKER_FIRST_PRIORITY + i;
+    }
+    order_ok = ok;
+    while (1) {
+        task_delay(1000, 0, 0);
+    }
+}
+
+void bad_user_init(){
+    for (uint32_t i = 0; i < WORKER_COUNT; i++) {
+        uint32_t prio = WORKER_FIRST_PRIORITY + (i * 7) % WORKER_COUNT;
+        bad_task_descr_t worker_descr = {
+            .stack = 0,
+            .stack_size = WORKER_STACK_SIZE,
+            .entry = worker,
+            .args = (void *)prio,
+            .ticks_to_change = 500,
+            .base_priority = prio
+        };
+        task_make(&worker_descr);
+    }
+    bad_task_descr_t checker_descr = {
+        .stack = 0,
+        .stack_size = CHECKER_STACK_SIZE,
+        .entry = checker,
+        .ticks_to_change = 500,
+        .base_priority = CHECKER_PRIORITY
+    };
+    task_make(&checker_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+#define BAD_RTOS_USE_HEAP_STATS
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// task1 drains the global pool and churns the kernel heap, checking the snapshots against
+// what it knows it holds, task2 is made and finishes every round to move the tcb counters
+// The mem_stats_tlsf target runs the same checks on the tlsf heap, without the per order lists
+
+bad_task_handle_t task1h;
+bad_task_handle_t task2h;
+
+volatile uint32_t rounds;
+volatile uint32_t mismatches;
+volatile uint32_t gpool_min_free;
+volatile uint32_t kheap_min_free;
+volatile uint32_t max_tasks;
+
+#define GPOOL_HOLD 8
+static const uint32_t sizes[] = {32, 100, 256, 1000};
+
+bad_mem_stats_t stats;
+
+void task2(void *unused){
+    (void)unused;
+    task_finish();
+}
+
+#define TASK1_PRIORITY 1
+#define TASK2_PRIORITY 2
+#define TASK1_STACK_SIZE 512
+#define TASK2_STACK_SIZE 256
+
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+TASK_STATIC_STACK(task2, TASK2_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task2)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task2_stack,TASK2_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task2)
+#endif
+
+void task1(void *unused){
+    (void)unused;
+    void *held[GPOOL_HOLD];
+    void *blocks[sizeof(sizes)/sizeof(sizes[0])];
+    while (1) {
+        kernel_mem_stats(&stats);
+        uint32_t gpool_free_before = stats.gpool.free;
+        uint32_t kheap_free_before = stats.kheap_free;
+        
+        for(uint32_t i = 0; i < GPOOL_HOLD; i++){
+            held[i] = gpool_alloc();
+        }
+        for(uint32_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++){
+            blocks[i] = kernel_alloc(sizes[i]);
+        }
+        
+        kernel_mem_stats(&stats);
+        uint32_t held_count = 0;
+        for(uint32_t i = 0; i < GPOOL_HOLD; i++){
+            held_count += !!held[i];
+        }
+        if(stats.gpool.free + held_count != gpool_free_before){
+            mismatches++;
+        }
+        if(stats.kheap_largest_free > stats.kheap_free || stats.kheap_min_free > stats.kheap_free){
+            mismatches++;
+        }
+#ifndef BAD_RTOS_USE_KHEAP_TLSF
+        uint32_t listed = 0;
+        for(uint32_t order = 0; order < 32; order++){
+            listed += (uint32_t)stats.kheap_free_blocks[order] << order;
+        }
+        if(listed != stats.kheap_free){
+            mismatches++;
+        }
+#endif
+        gpool_min_free = stats.gpool.min_free;
+        kheap_min_free = stats.kheap_min_free;
+        
+        for(uint32_t i = 0; i < GPOOL_HOLD; i++){
+            if(held[i]){
+                gpool_free(held[i]);
+            }
+        }
+        for(uint32_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++){
+            if(blocks[i]){
+                kernel_free(blocks[i], sizes[i]);
+            }
+        }
+        
+        bad_task_descr_t task2_descr = {
+            .stack = task2_stack,
+            .stack_size = TASK2_STACK_SIZE,
+            .entry = task2,
+#ifdef BAD_RTOS_USE_MPU
+            .regions = task2_regions,
+#endif
+            .ticks_to_change = 500,
+            .base_priority = TASK2_PRIORITY
+        };
+        task2h = task_make(&task2_descr);
+        task_delay(2, 0, 0);
+        
+        kernel_mem_stats(&stats);
+        if(stats.kheap_free != kheap_free_before || stats.gpool.free != gpool_free_before){
+            mismatches++;
+        }
+        max_tasks = stats.max_tasks;
+        rounds++;
+    }
+}
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+#define BAD_RTOS_ISR_TEST
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// Two producer tasks at different priorities and an isr post into one small queue, 
+// the consumer checks every producer sequence arrives in order without gaps 
+
+#define PRODUCERS 3
+#define ISR_PRODUCER 2
+
+bad_task_handle_t task1h;
+bad_task_handle_t task2h;
+bad_task_handle_t task3h;
+
+MSGQ_STATIC_INIT(task1q, 4);
+
+volatile uint32_t received[PRODUCERS];
+volatile uint32_t out_of_order;
+volatile uint32_t isr_dropped;
+volatile uint32_t post_errors;
+
+static uint32_t isr_seq;
+
+void task1(void *unused){
+    (void)unused;
+    uint32_t expected[PRODUCERS] = {0};
+    while (1) {
+        bad_msg_block_t msg = {0};
+        if(msgq_pull_msg(&task1q, &msg, 0) != BAD_RTOS_STATUS_OK || msg.signal >= PRODUCERS){
+            out_of_order++;
+            continue;
+        }
+        uint32_t seq = (uint32_t)msg.args;
+        if(seq != expected[msg.signal]){
+            out_of_order++;
+        }
+        expected[msg.signal] = seq + 1;
+        received[msg.signal]++;
+    }
+}
+
+static void producer(uint32_t id){
+    uint32_t seq = 0;
+    while (1) {
+        if(msgq_post_msg(&task1q, id, (void *)seq, 0) != BAD_RTOS_STATUS_OK){
+            post_errors++;
+            continue;
+        }
+        seq++;
+    }
+}
+
+void task2(void *unused){
+    (void)unused;
+    producer(0);
+}
+
+void task3(void *unused){
+    (void)unused;
+    producer(1);
+}
+
+void isr_test(){
+    if(msgq_post_msg_from_isr(&task1q, ISR_PRODUCER, (void *)isr_seq) == BAD_RTOS_STATUS_OK){
+        isr_seq++;
+    }else{
+        isr_dropped++;
+    }
+}
+
+#define TASK1_PRIORITY 2 
+#define TASK2_PRIORITY 2
+#define TASK3_PRIORITY 3
+#define TASK1_STACK_SIZE 1024
+#define TASK2_STACK_SIZE 1024
+#define TASK3_STACK_SIZE 1024
+TASK_STATIC_STACK(task2, TASK2_STACK_SIZE);
+TASK_STATIC_STACK(task3, TASK3_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task2)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task2_stack,TASK2_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task2)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task3)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task3_stack,TASK3_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task3)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = 0,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+        .ticks_to_change = 500,
+        .assigned_msgq = &task1q,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+    bad_task_descr_t task2_descr = {
+        .stack = task2_stack,
+        .stack_size = TASK2_STACK_SIZE,
+        .entry = task2,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task2_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK2_PRIORITY
+    };
+    task2h = task_make(&task2_descr);
+    bad_task_descr_t task3_descr = {
+        .stack = task3_stack,
+        .stack_size = TASK3_STACK_SIZE,
+        .entry = task3,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task3_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK3_PRIORITY
+    };
+    task3h = task_make(&task3_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
@@ -0,0 +1,189 @@
+#define BAD_RTOS_USE_SHARED_TIME
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// Mutex lock/unlock cost, thread mode ldrex/strex path against the svc path 
+// (what every take and put cost before). Uncontended loop in one task, then a ping-pong
+// between two equal priority tasks taking turns with task_yield, the mutex is always free there.
+// Last a contended round, a higher priority task blocks on the mutex task1 holds, boosts it
+// and gets it handed over on the put. The same round without the contender taking the mutex
+// is the baseline, the difference is the blocking take plus the handover.
+// Results are systick cycles per iteration, read with the debugger
+
+#define BENCH_ITERATIONS 1000
+
+typedef bad_rtos_status_t (*bench_take_t)(bad_mutex_t *mut,uint32_t delay);
+typedef bad_rtos_status_t (*bench_put_t)(bad_mutex_t *mut);
+
+bad_task_handle_t task1h;
+bad_task_handle_t task2h;
+bad_task_handle_t task3h;
+
+bad_mutex_t mut;
+bad_sem_t pong_start = {.init_flag = 1};
+bad_sem_t pong_done = {.init_flag = 1};
+bad_sem_t contend_go = {.init_flag = 1};
+
+volatile bench_take_t pong_take;
+volatile bench_put_t pong_put;
+
+volatile uint32_t bench_fast_cycles;
+volatile uint32_t bench_svc_cycles;
+volatile uint32_t bench_pingpong_fast_cycles;
+volatile uint32_t bench_pingpong_svc_cycles;
+volatile uint32_t bench_contended_cycles;
+volatile uint32_t bench_contended_base_cycles;
+volatile uint32_t contend_use_mutex;
+volatile uint32_t bench_errors;
+volatile uint32_t bench_done;
+
+static uint32_t bench_uncontended(bench_take_t take, bench_put_t put){
+    uint64_t start = kernel_timestamp();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        bench_errors += take(&mut, 0) != BAD_RTOS_STATUS_OK;
+        bench_errors += put(&mut) != BAD_RTOS_STATUS_OK;
+    }
+    return (uint32_t)((kernel_timestamp() - start) / BENCH_ITERATIONS);
+}
+
+static void bench_pong_round(bench_take_t take, bench_put_t put){
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        bench_errors += take(&mut, 0) != BAD_RTOS_STATUS_OK;
+        bench_errors += put(&mut) != BAD_RTOS_STATUS_OK;
+        task_yield();
+    }
+}
+
+static uint32_t bench_pingpong(bench_take_t take, bench_put_t put){
+    pong_take = take;
+    pong_put = put;
+    uint64_t start = kernel_timestamp();
+    sem_put(&pong_start);
+    bench_pong_round(take, put);
+    sem_take(&pong_done, 0);
+    return (uint32_t)((kernel_timestamp() - start) / (2 * BENCH_ITERATIONS));
+}
+
+static uint32_t bench_contended(uint32_t use_mutex){
+    contend_use_mutex = use_mutex;
+    uint64_t start = kernel_timestamp();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        bench_errors += mutex_take(&mut, 0) != BAD_RTOS_STATUS_OK;
+        sem_put(&contend_go); // the contender preempts and blocks on the mutex held here
+        bench_errors += mutex_put(&mut) != BAD_RTOS_STATUS_OK; // handed over, the contender runs and puts it
+    }
+    return (uint32_t)((kernel_timestamp() - start) / BENCH_ITERATIONS);
+}
+
+void task1(void *unused){
+    (void)unused;
+    bench_fast_cycles = bench_uncontended(mutex_take, mutex_put);
+    bench_svc_cycles = bench_uncontended(__svc_mutex_take, __svc_mutex_put);
+    bench_pingpong_fast_cycles = bench_pingpong(mutex_take, mutex_put);
+    bench_pingpong_svc_cycles = bench_pingpong(__svc_mutex_take, __svc_mutex_put);
+    bench_contended_base_cycles = bench_contended(0);
+    bench_contended_cycles = bench_contended(1);
+    bench_done = 1;
+    while (1) {
+        task_delay(1000, 0, 0);
+    }
+}
+
+void task2(void *unused){
+    (void)unused;
+    while (1) {
+        sem_take(&pong_start, 0);
+        bench_pong_round(pong_take, pong_put);
+        sem_put(&pong_done);
+    }
+}
+
+void task3(void *unused){
+    (void)unused;
+    while (1) {
+        sem_take(&contend_go, 0);
+        if(contend_use_mutex){
+            bench_errors += mutex_take(&mut, 0) != BAD_RTOS_STATUS_OK;
+            bench_errors += mutex_put(&mut) != BAD_RTOS_STATUS_OK;
+        }
+    }
+}
+
+#define TASK1_PRIORITY 1 
+#define TASK2_PRIORITY 1
+#define TASK3_PRIORITY 0
+#define TASK2_STACK_SIZE 1024
+#define TASK1_STACK_SIZE 1024
+#define TASK3_STACK_SIZE 512
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+TASK_STATIC_STACK(task2, TASK2_STACK_SIZE);
+TASK_STATIC_STACK(task3, TASK3_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task2)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task2_stack,TASK2_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task2)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task3)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task3_stack,TASK3_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task3)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+    bad_task_descr_t task2_descr = {
+        .stack = task2_stack,
+        .stack_size = TASK2_STACK_SIZE,
+        .entry = task2,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task2_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK2_PRIORITY
+    };
+    task2h = task_make(&task2_descr);
+    bad_task_descr_t task3_descr = {
+        .stack = task3_stack,
+        .stack_size = TASK3_STACK_SIZE,
+        .entry = task3,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task3_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK3_PRIORITY
+    };
+    task3h = task_make(&task3_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+#define BAD_RTOS_USE_PERIODIC_TASKS
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+bad_task_handle_t task1h;
+bad_task_handle_t task2h;
+
+volatile uint32_t task1_releases;
+volatile uint32_t task2_releases;
+volatile uint32_t task2_overrun_status;
+volatile bad_period_stats_t task1_stats;
+volatile bad_period_stats_t task2_stats;
+
+#define TASK1_BUSY_LOOPS 100000 //a few ms of work
+
+// 1 kHz loop using task_delay_until, overruns on purpose every 100 releases
+void task1(void *unused){
+    (void)unused;
+    uint32_t last_wake = 0; //tasks start at tick 0
+    while (1) {
+        if(task1_releases % 100 == 99){
+            for (volatile uint32_t i = 0; i < TASK1_BUSY_LOOPS; i++) {
+                
+            }
+        }
+        task_delay_until(&last_wake, 1);
+        task1_releases++;
+        task_period_stats(task1h, (bad_period_stats_t *)&task1_stats);
+    }
+}
+
+// 250 Hz loop created with a period in the descriptor
+void task2(void *unused){
+    (void)unused;
+    while (1) {
+        bad_rtos_status_t status = task_wait_period();
+        if(status == BAD_RTOS_STATUS_OVERRUN){
+            task2_overrun_status++;
+        }
+        task2_releases++;
+        task_period_stats(task2h, (bad_period_stats_t *)&task2_stats);
+    }
+}
+
+#define TASK1_PRIORITY 1 
+#define TASK2_PRIORITY 2
+#define TASK2_STACK_SIZE 1024
+#define TASK1_STACK_SIZE 1024
+TASK_STATIC_STACK(task2, TASK2_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task2)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task2_stack,TASK2_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task2)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = 0,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+    bad_task_descr_t task2_descr = {
+        .stack = task2_stack,
+        .stack_size = TASK2_STACK_SIZE,
+        .entry = task2,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task2_regions,
+#endif
+        .period = 4,
+        .ticks_to_change = 500,
+        .base_priority = TASK2_PRIORITY
+    };
+    task2h = task_make(&task2_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
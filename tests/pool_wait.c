@@ -0,0 +1,174 @@
+#define BAD_RTOS_ISR_TEST
+#define BAD_RTOS_USE_POOL_WAIT
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// Three blocks shared by three tasks, every task waits on the empty pool at some point,
+// task1 returns every other block through the isr so pendsv hands it over,
+// task2 waits with a timeout, task3 hogs two blocks at a time
+
+bad_task_handle_t task1h;
+bad_task_handle_t task2h;
+bad_task_handle_t task3h;
+
+#define POOL_BLOCKS 3
+#define BLOCK_SIZE 32
+
+static uint8_t __attribute__((aligned(4))) pool_mem[POOL_BLOCKS * BLOCK_SIZE];
+bad_pool_t pool;
+
+void * volatile isr_slot;
+
+volatile uint32_t task1_got;
+volatile uint32_t task2_got;
+volatile uint32_t task2_timeouts;
+volatile uint32_t task3_rounds;
+volatile uint32_t isr_frees;
+volatile uint32_t unexpected_null;
+
+void isr_test(){
+    void *block = isr_slot;
+    if(block){
+        isr_slot = 0;
+        pool_free(&pool, block);
+        isr_frees++;
+    }
+}
+
+void task1(void *unused){
+    (void)unused;
+    while (1) {
+        uint8_t *block = pool_alloc_wait(&pool, 0);
+        if(!block){
+            unexpected_null++;
+            continue;
+        }
+        task1_got++;
+        block[0] = 1;
+        if(task1_got & 1){
+            while(isr_slot){
+                task_delay(1, 0, 0);
+            }
+            isr_slot = block;
+        }else{
+            task_delay(1, 0, 0);
+            pool_free(&pool, block);
+        }
+    }
+}
+
+void task2(void *unused){
+    (void)unused;
+    while (1) {
+        uint8_t *block = pool_alloc_wait(&pool, 3);
+        if(!block){
+            task2_timeouts++;
+            continue;
+        }
+        task2_got++;
+        block[0] = 2;
+        task_delay(2, 0, 0);
+        pool_free(&pool, block);
+    }
+}
+
+void task3(void *unused){
+    (void)unused;
+    while (1) {
+        uint8_t *first = pool_alloc_wait(&pool, 0);
+        uint8_t *second = pool_alloc_wait(&pool, 0);
+        if(!first || !second){
+            unexpected_null++;
+        }
+        task_delay(5, 0, 0);
+        if(first){
+            pool_free(&pool, first);
+        }
+        if(second){
+            pool_free(&pool, second);
+        }
+        task3_rounds++;
+        task_delay(3, 0, 0);
+    }
+}
+
+#define TASK1_PRIORITY 1
+#define TASK2_PRIORITY 2
+#define TASK3_PRIORITY 3
+#define TASK1_STACK_SIZE 512
+#define TASK2_STACK_SIZE 512
+#define TASK3_STACK_SIZE 512
+
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+TASK_STATIC_STACK(task2, TASK2_STACK_SIZE);
+TASK_STATIC_STACK(task3, TASK3_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task2)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task2_stack,TASK2_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task2)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task3)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task3_stack,TASK3_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task3)
+#endif
+
+void bad_user_init(){
+    pool_init(&pool, pool_mem, BLOCK_SIZE, sizeof(pool_mem));
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+    bad_task_descr_t task2_descr = {
+        .stack = task2_stack,
+        .stack_size = TASK2_STACK_SIZE,
+        .entry = task2,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task2_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK2_PRIORITY
+    };
+    task2h = task_make(&task2_descr);
+    bad_task_descr_t task3_descr = {
+        .stack = task3_stack,
+        .stack_size = TASK3_STACK_SIZE,
+        .entry = task3,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task3_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK3_PRIORITY
+    };
+    task3h = task_make(&task3_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+#define BAD_RTOS_USE_SLAB
+#define KMAX_ORDER 13
+#define BAD_RTOS_ISR_TEST
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// The task churns every size class plus one size past the caches, the timer isr
+// takes 24 byte objects from the same class while the task refills it
+
+bad_task_handle_t task1h;
+
+volatile uint32_t rounds;
+volatile uint32_t alloc_fails;
+volatile uint32_t corruptions;
+volatile uint32_t isr_allocs;
+volatile uint32_t isr_empty;
+
+static const uint32_t sizes[] = {8, 24, 16, 40, 100, 200, 512, 600, 3};
+
+void isr_test(){
+    uint8_t *obj = slab_alloc(24);
+    if(!obj){
+        isr_empty++;
+        return;
+    }
+    obj[23] = 0x5A;
+    isr_allocs++;
+    slab_free(obj, 24);
+}
+
+void task1(void *unused){
+    (void)unused;
+    uint8_t *objs[sizeof(sizes)/sizeof(sizes[0])][2];
+    while (1) {
+        for(uint32_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++){
+            for(uint32_t j = 0; j < 2; j++){
+                objs[i][j] = slab_alloc(sizes[i]);
+                if(!objs[i][j]){
+                    alloc_fails++;
+                    continue;
+                }
+                for(uint32_t k = 0; k < sizes[i]; k++){
+                    objs[i][j][k] = (uint8_t)(i + j);
+                }
+            }
+        }
+        task_delay(1, 0, 0);
+        for(uint32_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++){
+            for(uint32_t j = 0; j < 2; j++){
+                if(!objs[i][j]){
+                    continue;
+                }
+                for(uint32_t k = 0; k < sizes[i]; k++){
+                    if(objs[i][j][k] != (uint8_t)(i + j)){
+                        corruptions++;
+                        break;
+                    }
+                }
+                slab_free(objs[i][j], sizes[i]);
+            }
+        }
+        rounds++;
+    }
+}
+
+#define TASK1_PRIORITY 1
+#define TASK1_STACK_SIZE 1024
+
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
@@ -0,0 +1,161 @@
+#define BAD_RTOS_USE_STACK_WATERMARK
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// task1 goes deep once, task2 stays shallow, task3 checks that the peaks
+// order the same way and prints the report into a buffer, read it with the debugger
+
+bad_task_handle_t task1h;
+bad_task_handle_t task2h;
+bad_task_handle_t task3h;
+
+volatile uint32_t task1_used;
+volatile uint32_t task2_used;
+volatile uint32_t msp_used;
+volatile uint32_t mismatches;
+volatile uint32_t reports;
+
+char report[512];
+uint32_t report_len;
+
+void report_putc(char c){
+    if(report_len < sizeof(report) - 1){
+        report[report_len++] = c;
+    }
+}
+
+uint32_t __attribute__((noinline)) deep(uint32_t depth){
+    volatile uint32_t frame[16];
+    for(uint32_t i = 0; i < 16; i++){
+        frame[i] = depth + i;
+    }
+    if(!depth){
+        return frame[0];
+    }
+    return deep(depth - 1) + frame[15];
+}
+
+void task1(void *unused){
+    (void)unused;
+    deep(8);
+    while (1) {
+        task_delay(10, 0, 0);
+    }
+}
+
+void task2(void *unused){
+    (void)unused;
+    while (1) {
+        task_delay(10, 0, 0);
+    }
+}
+
+void task3(void *unused){
+    (void)unused;
+    bad_stack_stats_t stats;
+    while (1) {
+        task_delay(20, 0, 0);
+        if(stack_stats(task1h, &stats) != BAD_RTOS_STATUS_OK){
+            mismatches++;
+        }
+        task1_used = stats.used;
+        if(stats.recommended < stats.used || stats.recommended % 32){
+            mismatches++;
+        }
+        if(stack_stats(task2h, &stats) != BAD_RTOS_STATUS_OK){
+            mismatches++;
+        }
+        task2_used = stats.used;
+        if(task1_used <= task2_used){
+            mismatches++;
+        }
+        if(stack_stats(BAD_STACK_MSP, &stats) != BAD_RTOS_STATUS_OK){
+            mismatches++;
+        }
+        msp_used = stats.used;
+        report_len = 0;
+        stack_report(report_putc);
+        report[report_len] = 0;
+        reports++;
+    }
+}
+
+#define TASK1_PRIORITY 1
+#define TASK2_PRIORITY 2
+#define TASK3_PRIORITY 3
+#define TASK1_STACK_SIZE 1024
+#define TASK2_STACK_SIZE 512
+#define TASK3_STACK_SIZE 512
+
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+TASK_STATIC_STACK(task2, TASK2_STACK_SIZE);
+TASK_STATIC_STACK(task3, TASK3_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task2)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task2_stack,TASK2_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task2)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task3)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task3_stack,TASK3_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task3)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+    bad_task_descr_t task2_descr = {
+        .stack = task2_stack,
+        .stack_size = TASK2_STACK_SIZE,
+        .entry = task2,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task2_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK2_PRIORITY
+    };
+    task2h = task_make(&task2_descr);
+    bad_task_descr_t task3_descr = {
+        .stack = task3_stack,
+        .stack_size = TASK3_STACK_SIZE,
+        .entry = task3,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task3_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK3_PRIORITY
+    };
+    task3h = task_make(&task3_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
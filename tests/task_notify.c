@@ -0,0 +1,156 @@
+#define BAD_RTOS_USE_TASK_NOTIFY
+#define BAD_RTOS_ISR_TEST
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// task1 waits on bits set by the isr and by task2, task3 counts increments sent by task2
+// every increment has to show up in task3 even when several land before it runs
+
+#define ISR_BIT  (1UL << 0)
+#define TASK_BIT (1UL << 1)
+
+bad_task_handle_t task1h;
+bad_task_handle_t task2h;
+bad_task_handle_t task3h;
+
+volatile uint32_t isr_wakes;
+volatile uint32_t task_wakes;
+volatile uint32_t timeouts;
+volatile uint32_t isr_notifies;
+volatile uint32_t increments_sent;
+volatile uint32_t increments_seen;
+volatile uint32_t notify_errors;
+
+void task1(void *unused){
+    (void)unused;
+    while (1) {
+        uint32_t value = 0;
+        bad_rtos_status_t res = task_notify_wait(ISR_BIT | TASK_BIT, 100, &value);
+        if(res == BAD_RTOS_STATUS_TIMEOUT){
+            timeouts++;
+            continue;
+        }
+        if(res != BAD_RTOS_STATUS_OK){
+            notify_errors++;
+            continue;
+        }
+        if(value & ISR_BIT){
+            isr_wakes++;
+        }
+        if(value & TASK_BIT){
+            task_wakes++;
+        }
+    }
+}
+
+void task2(void *unused){
+    (void)unused;
+    while (1) {
+        task_delay(10, 0, 0);
+        if(task_notify(task1h, TASK_BIT, BAD_NOTIFY_SET_BITS) != BAD_RTOS_STATUS_OK){
+            notify_errors++;
+        }
+        for(uint32_t i = 0; i < 3; i++){
+            if(task_notify(task3h, 0, BAD_NOTIFY_INCREMENT) == BAD_RTOS_STATUS_OK){
+                increments_sent++;
+            }
+        }
+    }
+}
+
+void task3(void *unused){
+    (void)unused;
+    while (1) {
+        uint32_t value = 0;
+        if(task_notify_wait(UINT32_MAX, 0, &value) == BAD_RTOS_STATUS_OK){
+            increments_seen += value;
+        }else{
+            notify_errors++;
+        }
+    }
+}
+
+void isr_test(){
+    if(task_notify_from_isr(task1h, ISR_BIT, BAD_NOTIFY_SET_BITS) == BAD_RTOS_STATUS_OK){
+        isr_notifies++;
+    }
+}
+
+#define TASK1_PRIORITY 1 
+#define TASK2_PRIORITY 2
+#define TASK3_PRIORITY 3
+#define TASK1_STACK_SIZE 1024
+#define TASK2_STACK_SIZE 1024
+#define TASK3_STACK_SIZE 1024
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+TASK_STATIC_STACK(task2, TASK2_STACK_SIZE);
+TASK_STATIC_STACK(task3, TASK3_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task2)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task2_stack,TASK2_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task2)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task3)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task3_stack,TASK3_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task3)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+    bad_task_descr_t task2_descr = {
+        .stack = task2_stack,
+        .stack_size = TASK2_STACK_SIZE,
+        .entry = task2,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task2_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK2_PRIORITY
+    };
+    task2h = task_make(&task2_descr);
+    bad_task_descr_t task3_descr = {
+        .stack = task3_stack,
+        .stack_size = TASK3_STACK_SIZE,
+        .entry = task3,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task3_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK3_PRIORITY
+    };
+    task3h = task_make(&task3_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+#define BAD_RTOS_USE_THREADED_IRQ
+#define BAD_RTOS_ISR_TEST
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// The timer isr pends an otherwise unused line, its vector is threaded so the work runs in handler_task
+// pends that come in while the handler works stay latched in the masked line and fold into one run
+
+#if defined(BAD_PLATFORM_F411)
+#define THREADED_LINE NVIC_EXTI0_INTR
+#else
+#define THREADED_LINE EXTI0_INTR
+#endif
+
+THREADED_IRQ_HANDLER(exti0_isr)
+
+bad_task_handle_t handlerh;
+bad_task_handle_t task1h;
+
+volatile uint32_t pends;
+volatile uint32_t handled;
+volatile uint32_t wait_errors;
+volatile uint32_t register_status;
+
+void handler_task(void *unused){
+    (void)unused;
+    while (1) {
+        if(irq_thread_wait(THREADED_LINE) != BAD_RTOS_STATUS_OK){
+            wait_errors++;
+            continue;
+        }
+        handled++;
+        task_delay(2, 0, 0); //slow handler, the timer keeps pending meanwhile
+    }
+}
+
+void task1(void *unused){
+    (void)unused;
+    while (1) {
+        if(irq_thread_wait(THREADED_LINE) != BAD_RTOS_STATUS_NOT_OWNER){
+            wait_errors++;
+        }
+        task_delay(10, 0, 0);
+    }
+}
+
+void isr_test(){
+    NVIC->ISPR[THREADED_LINE >> 5] = 1U << (THREADED_LINE & 0x1F);
+    pends++;
+}
+
+#define HANDLER_PRIORITY 1
+#define TASK1_PRIORITY 2
+#define HANDLER_STACK_SIZE 512
+#define TASK1_STACK_SIZE 512
+
+TASK_STATIC_STACK(handler, HANDLER_STACK_SIZE);
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(handler)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(handler_stack,HANDLER_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(handler)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t handler_descr = {
+        .stack = handler_stack,
+        .stack_size = HANDLER_STACK_SIZE,
+        .entry = handler_task,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = handler_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = HANDLER_PRIORITY
+    };
+    handlerh = task_make(&handler_descr);
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+    nvic_set_interrupt_priority(THREADED_LINE, NVIC_PRIO13);
+    register_status = irq_thread_register(THREADED_LINE, handlerh);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+#define BAD_RTOS_USE_SHARED_TIME
+#define BAD_RTOS_ISR_TEST
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#define BAD_RTOS_IMPLEMENTATION
+#include "platform_include.h"
+
+bad_task_handle_t task1h;
+
+volatile uint64_t task_last_stamp;
+volatile uint64_t task_last_ticks;
+volatile uint32_t task_samples;
+volatile uint32_t task_backwards;
+
+volatile uint64_t isr_last_stamp;
+volatile uint32_t isr_samples;
+volatile uint32_t isr_backwards;
+
+void task1(void *unused){
+    (void)unused;
+    uint64_t prev_stamp = 0;
+    uint64_t prev_ticks = 0;
+    while (1) {
+        uint64_t ticks = kernel_ticks64();
+        uint64_t stamp = kernel_timestamp();
+        if(stamp < prev_stamp || ticks < prev_ticks){
+            task_backwards++;
+        }
+        prev_stamp = stamp;
+        prev_ticks = ticks;
+        task_last_stamp = stamp;
+        task_last_ticks = ticks;
+        task_samples++;
+        if((task_samples & 0xFF) == 0){
+            task_delay(1, 0, 0);
+        }
+    }
+}
+
+void isr_test(){
+    uint64_t stamp = kernel_timestamp();
+    if(stamp < isr_last_stamp){
+        isr_backwards++;
+    }
+    isr_last_stamp = stamp;
+    isr_samples++;
+}
+
+#define TASK1_PRIORITY 1 
+#define TASK1_STACK_SIZE 1024
+
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+#define BAD_RTOS_USE_KHEAP_TLSF
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#define BAD_RTOS_IMPLEMENTATION
+#include "platform_include.h"
+
+// Two tasks on 1056 byte heap stacks (2048 each with the buddy) churn odd sized allocations,
+// every block is filled and checked before it is freed, everything fits in the default 4 KB heap
+
+bad_task_handle_t task1h;
+bad_task_handle_t task2h;
+volatile uint32_t rounds;
+volatile uint32_t alloc_fails;
+volatile uint32_t corruptions;
+
+static const uint32_t sizes[] = {24, 100, 1, 300, 56, 200, 12};
+
+void churn(void *arg){
+    uint8_t seed = (uint8_t)(uint32_t)arg;
+    uint8_t *blocks[sizeof(sizes)/sizeof(sizes[0])];
+    while (1) {
+        for(uint32_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++){
+            blocks[i] = kernel_alloc(sizes[i]);
+            if(!blocks[i]){
+                alloc_fails++;
+                continue;
+            }
+            for(uint32_t j = 0; j < sizes[i]; j++){
+                blocks[i][j] = seed + i;
+            }
+        }
+        task_yield();
+        for(uint32_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++){
+            if(!blocks[i]){
+                continue;
+            }
+            for(uint32_t j = 0; j < sizes[i]; j++){
+                if(blocks[i][j] != (uint8_t)(seed + i)){
+                    corruptions++;
+                    break;
+                }
+            }
+            kernel_free(blocks[i], sizes[i]);
+        }
+        rounds++;
+        task_delay(5, 0, 0);
+    }
+}
+
+#define TASK1_PRIORITY 1 
+#define TASK2_PRIORITY 1
+#define TASK1_STACK_SIZE 1056
+#define TASK2_STACK_SIZE 1056
+
+void bad_user_init(){
+    bad_task_descr_t task1_descr = {
+        .stack = 0,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = churn,
+        .args = (void *)0x10,
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+    bad_task_descr_t task2_descr = {
+        .stack = 0,
+        .stack_size = TASK2_STACK_SIZE,
+        .entry = churn,
+        .args = (void *)0x80,
+        .ticks_to_change = 500,
+        .base_priority = TASK2_PRIORITY
+    };
+    task2h = task_make(&task2_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
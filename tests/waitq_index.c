@@ -0,0 +1,128 @@
+#define BAD_RTOS_USE_WAITQ_INDEX
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// Waiters block on the semaphore in order B(1) C(2) E(2, times out) D(2) A(3)
+// expected wake order B C D A, E reports a timeout
+// With the default 8 index levels priorities 1 to 3 share level 0, so the order inside a level is checked too
+
+bad_sem_t sem;
+
+volatile uint32_t wake_pos;
+volatile uint32_t wake_order[4];
+volatile uint32_t waiter_e_status;
+
+void waiter(void *id){
+    sem_take(&sem,0);
+    wake_order[wake_pos++] = (uint32_t)id;
+    while (1) {
+        task_delay(1000, 0, 0);
+    }
+}
+
+void waiter_e(void *unused){
+    (void)unused;
+    waiter_e_status = sem_take(&sem,5);
+    while (1) {
+        task_delay(1000, 0, 0);
+    }
+}
+
+void poster(void *unused){
+    (void)unused;
+    task_delay(10, 0, 0);
+    for (uint32_t i = 0; i < 4; i++) {
+        sem_put(&sem);
+    }
+    while (1) {
+        task_delay(1000, 0, 0);
+    }
+}
+
+#define WAITER_STACK_SIZE 512
+#define POSTER_PRIORITY 5
+TASK_STATIC_STACK(waiter_a, WAITER_STACK_SIZE);
+TASK_STATIC_STACK(waiter_b, WAITER_STACK_SIZE);
+TASK_STATIC_STACK(waiter_c, WAITER_STACK_SIZE);
+TASK_STATIC_STACK(waiter_d, WAITER_STACK_SIZE);
+TASK_STATIC_STACK(waiter_e, WAITER_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(waiter_a)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(waiter_a_stack,WAITER_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(waiter_a)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(waiter_b)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(waiter_b_stack,WAITER_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(waiter_b)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(waiter_c)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(waiter_c_stack,WAITER_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(waiter_c)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(waiter_d)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(waiter_d_stack,WAITER_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(waiter_d)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(waiter_e)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(waiter_e_stack,WAITER_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(waiter_e)
+#endif
+
+#ifdef BAD_RTOS_USE_MPU
+#define WAITER_DESCR(name, entry_fn, id, prio) (bad_task_descr_t){ \
+        .stack = name##_stack, .stack_size = WAITER_STACK_SIZE, .entry = entry_fn, \
+        .args = (void *)(id), .regions = name##_regions, \
+        .ticks_to_change = 500, .base_priority = prio }
+#else
+#define WAITER_DESCR(name, entry_fn, id, prio) (bad_task_descr_t){ \
+        .stack = name##_stack, .stack_size = WAITER_STACK_SIZE, .entry = entry_fn, \
+        .args = (void *)(id), \
+        .ticks_to_change = 500, .base_priority = prio }
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t descr;
+    descr = WAITER_DESCR(waiter_a, waiter, 'A', 3);
+    task_make(&descr);
+    descr = WAITER_DESCR(waiter_b, waiter, 'B', 1);
+    task_make(&descr);
+    descr = WAITER_DESCR(waiter_c, waiter, 'C', 2);
+    task_make(&descr);
+    descr = WAITER_DESCR(waiter_e, waiter_e, 'E', 2);
+    task_make(&descr);
+    descr = WAITER_DESCR(waiter_d, waiter, 'D', 2);
+    task_make(&descr);
+    bad_task_descr_t poster_descr = {
+        .stack = 0,
+        .stack_size = 1024,
+        .entry = poster,
+        .ticks_to_change = 500,
+        .base_priority = POSTER_PRIORITY
+    };
+    task_make(&poster_descr);
+    sem_init(&sem, 0);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+#define BAD_RTOS_USE_WORKQ
+#define BAD_RTOS_ISR_TEST
+#define BAD_RTOS_IMPLEMENTATION
+#define BAD_RTOS_PLATFORM_IMPLEMENTATION
+#include "platform_include.h"
+
+// The timer isr defers two items to a pair of workers, the fast one is submitted twice
+// per interrupt and has to run once per interrupt since the first submit is still pending
+
+bad_task_handle_t worker1h;
+bad_task_handle_t worker2h;
+bad_task_handle_t task1h;
+
+volatile uint32_t fast_runs;
+volatile uint32_t slow_runs;
+volatile uint32_t submits;
+volatile uint32_t refused;
+
+void fast_work(void *arg){
+    (*(volatile uint32_t *)arg)++;
+}
+
+void slow_work(void *arg){
+    (*(volatile uint32_t *)arg)++;
+    task_delay(2, 0, 0); //work may block, the other worker keeps draining
+}
+
+WORK_STATIC_INIT(fast_item, fast_work, (void *)&fast_runs)
+WORK_STATIC_INIT(slow_item, slow_work, (void *)&slow_runs)
+
+void task1(void *unused){
+    (void)unused;
+    while (1) {
+        
+    }
+}
+
+void isr_test(){
+    if(work_submit_from_isr(&slow_item) == BAD_RTOS_STATUS_OK){
+        submits++;
+    }
+    if(work_submit_from_isr(&fast_item) == BAD_RTOS_STATUS_OK){
+        submits++;
+    }
+    if(work_submit_from_isr(&fast_item) == BAD_RTOS_STATUS_IN_USE){
+        refused++;
+    }
+}
+
+#define WORKER1_PRIORITY 1
+#define WORKER2_PRIORITY 2
+#define TASK1_PRIORITY 3
+#define WORKER1_STACK_SIZE 512
+#define WORKER2_STACK_SIZE 512
+#define TASK1_STACK_SIZE 512
+
+TASK_STATIC_STACK(worker1, WORKER1_STACK_SIZE);
+TASK_STATIC_STACK(worker2, WORKER2_STACK_SIZE);
+TASK_STATIC_STACK(task1, TASK1_STACK_SIZE);
+
+#ifdef BAD_RTOS_USE_MPU
+START_TASK_MPU_REGIONS_DEFINITIONS(worker1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(worker1_stack,WORKER1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(worker1)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(worker2)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(worker2_stack,WORKER2_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(worker2)
+
+START_TASK_MPU_REGIONS_DEFINITIONS(task1)
+#if defined(BAD_PLATFORM_H562) || defined(BAD_PLATFORM_H562T)
+DEFINE_STATIC_STACK_REGION(task1_stack,TASK1_STACK_SIZE)
+#endif
+END_TASK_MPU_REGIONS(task1)
+#endif
+
+void bad_user_init(){
+    bad_task_descr_t worker1_descr = {
+        .stack = worker1_stack,
+        .stack_size = WORKER1_STACK_SIZE,
+        .entry = work_worker,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = worker1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = WORKER1_PRIORITY
+    };
+    worker1h = task_make(&worker1_descr);
+    bad_task_descr_t worker2_descr = {
+        .stack = worker2_stack,
+        .stack_size = WORKER2_STACK_SIZE,
+        .entry = work_worker,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = worker2_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = WORKER2_PRIORITY
+    };
+    worker2h = task_make(&worker2_descr);
+    bad_task_descr_t task1_descr = {
+        .stack = task1_stack,
+        .stack_size = TASK1_STACK_SIZE,
+        .entry = task1,
+#ifdef BAD_RTOS_USE_MPU
+        .regions = task1_regions,
+#endif
+        .ticks_to_change = 500,
+        .base_priority = TASK1_PRIORITY
+    };
+    task1h = task_make(&task1_descr);
+}
+
+
+int __attribute__((noinline)) main(){
+    __DISABLE_INTERUPTS;
+    __platform_setup();
+    __ENABLE_INTERUPTS;
+    bad_rtos_start();
+    while(1){
+        
+    }
+    return 0;
+}